@@ -0,0 +1,172 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+#include "arena.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+arena::arena(std::size_t bytes, bool huge_pages)
+    : m_data(NULL), m_size(0), m_huge_pages(false), m_mmapped(false),
+      m_read_only(false), m_mapping(NULL), m_mapping_size(0) {
+  if (!bytes)
+    return;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (huge_pages) {
+    m_size = align_up(bytes, huge_page_size);
+    void *ptr = mmap(NULL, m_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr != MAP_FAILED) {
+      // transparent huge pages are only a hint, we keep the slab if the
+      // kernel refuses it
+      m_huge_pages = (madvise(ptr, m_size, MADV_HUGEPAGE) == 0);
+      m_mmapped = true;
+      m_mapping = ptr;
+      m_mapping_size = m_size;
+      m_data = static_cast<char *>(ptr);
+      return;
+    }
+  }
+#endif
+
+  const std::size_t alignment = huge_pages ? huge_page_size : field_alignment;
+  m_size = align_up(bytes, alignment);
+  void *ptr = NULL;
+  if (posix_memalign(&ptr, alignment, m_size))
+    throw std::bad_alloc();
+  m_data = static_cast<char *>(ptr);
+}
+
+arena::arena(int fd, std::size_t offset, std::size_t bytes)
+    : m_data(NULL), m_size(bytes), m_huge_pages(false), m_mmapped(true),
+      m_read_only(false), m_mapping(NULL), m_mapping_size(0) {
+  if (!bytes)
+    return;
+
+  const std::size_t page = sysconf(_SC_PAGESIZE);
+  const std::size_t delta = offset % page;
+  m_mapping_size = bytes + delta;
+  m_mapping = mmap(NULL, m_mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                   fd, offset - delta);
+  if (m_mapping == MAP_FAILED) {
+    m_mapping = NULL;
+    m_mmapped = false;
+    throw(std::runtime_error(std::string("Can not map the file: ") +
+                             std::strerror(errno)));
+  }
+  m_data = static_cast<char *>(m_mapping) + delta;
+}
+
+arena::~arena() {
+  if (!m_data)
+    return;
+  if (m_mmapped) {
+    munmap(m_mapping, m_mapping_size);
+    return;
+  }
+  // the allocator writes to the freed memory
+  if (m_read_only)
+    mprotect(m_data, m_size, PROT_READ | PROT_WRITE);
+  free(m_data);
+}
+
+void arena::protect(bool read_only) {
+  if (!m_data || read_only == m_read_only)
+    return;
+  // the slab is aligned to the pages, unlike the data of a file mapping
+  void *begin = m_mmapped ? m_mapping : m_data;
+  const std::size_t bytes = m_mmapped ? m_mapping_size : m_size;
+  if (mprotect(begin, bytes, read_only ? PROT_READ : PROT_READ | PROT_WRITE))
+    throw(std::runtime_error(std::string("Can not protect the arena: ") +
+                             std::strerror(errno)));
+  m_read_only = read_only;
+}
+
+void arena::first_touch(std::size_t offset, std::size_t bytes) {
+  char *begin = m_data + offset;
+#pragma omp parallel
+  {
+#ifdef _OPENMP
+    const std::size_t nthreads = omp_get_num_threads();
+    const std::size_t tid = omp_get_thread_num();
+#else
+    const std::size_t nthreads = 1;
+    const std::size_t tid = 0;
+#endif
+    const std::size_t chunk = (bytes + nthreads - 1) / nthreads;
+    const std::size_t first = tid * chunk;
+    if (first < bytes)
+      std::memset(begin + first, 0,
+                  (first + chunk < bytes) ? chunk : bytes - first);
+  }
+}
+
+void arena::read(int fd, std::size_t file_offset, std::size_t bytes) {
+  bool failed = false;
+#pragma omp parallel reduction(|| : failed)
+  {
+#ifdef _OPENMP
+    const std::size_t nthreads = omp_get_num_threads();
+    const std::size_t tid = omp_get_thread_num();
+#else
+    const std::size_t nthreads = 1;
+    const std::size_t tid = 0;
+#endif
+    // the parts are aligned to the fields, as the offsets in the file
+    const std::size_t chunk =
+        align_up((bytes + nthreads - 1) / nthreads, field_alignment);
+    std::size_t first = tid * chunk;
+    const std::size_t last = (first + chunk < bytes) ? first + chunk : bytes;
+    while (first < last && !failed) {
+      const ssize_t res =
+          pread(fd, m_data + first, last - first, file_offset + first);
+      if (res > 0)
+        first += res;
+      else if (res == 0 || errno != EINTR)
+        failed = true;
+    }
+  }
+  if (failed)
+    throw(std::runtime_error("Can not read the arena from the file"));
+}
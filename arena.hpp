@@ -0,0 +1,103 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+#pragma once
+#include <cstddef>
+
+/**
+ * Selects how the storages of a repository are allocated:
+ *  - per_field: each data store allocates its own memory
+ *  - arena: all the fields of a repository are placed in a single aligned
+ *    slab, first touched in parallel
+ *  - arena_huge_pages: as arena, with the slab backed by huge pages
+ */
+enum class allocation_mode { per_field, arena, arena_huge_pages };
+
+/**
+ * Single slab of memory holding all the fields of a repository.
+ * The slab is page aligned (huge page aligned if requested) and it is not
+ * initialized, so that the pages are mapped by the first_touch() of the
+ * threads that will later compute on them.
+ */
+class arena {
+public:
+  // alignment (in bytes) of each of the fields placed in the arena
+  static constexpr std::size_t field_alignment = 4096;
+  static constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+  arena(std::size_t bytes, bool huge_pages);
+  // private (copy on write) mapping of the region [offset, offset + bytes)
+  // of the file fd, modifications of the slab are not written to the file
+  arena(int fd, std::size_t offset, std::size_t bytes);
+  ~arena();
+
+  arena(arena const &) = delete;
+  arena &operator=(arena const &) = delete;
+
+  char *data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+  bool huge_pages() const { return m_huge_pages; }
+
+  // zero initializes the region [offset, offset + bytes) of the slab, with a
+  // static partition among the threads, the same one used by the operators,
+  // so that each thread's part lands on its own NUMA node
+  void first_touch(std::size_t offset, std::size_t bytes);
+
+  // reads the first bytes of the slab from the file fd, starting at
+  // file_offset. Each thread reads its part of the static partition used by
+  // first_touch, so that the reads are large, and the pages land on the
+  // NUMA node of the thread
+  void read(int fd, std::size_t file_offset, std::size_t bytes);
+
+  // makes the slab read only (writes to it fault), or writable again
+  void protect(bool read_only);
+  bool read_only() const { return m_read_only; }
+
+  static std::size_t align_up(std::size_t bytes, std::size_t alignment) {
+    return ((bytes + alignment - 1) / alignment) * alignment;
+  }
+
+private:
+  char *m_data;
+  std::size_t m_size;
+  bool m_huge_pages;
+  bool m_mmapped;
+  bool m_read_only;
+  // mapped region, that starts before m_data if the file offset is not
+  // aligned to the page size
+  void *m_mapping;
+  std::size_t m_mapping_size;
+};
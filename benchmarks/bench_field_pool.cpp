@@ -0,0 +1,281 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+// Microbenchmarks of the hot paths of the field management layer:
+//  - field_pool::get_st
+//  - field_pool::bind_arg and get_arg
+//  - field_pool::activate_context / deactivate_context
+//  - field_pool::get_scratch, with the temporary released at once
+//  - repository construction and allocation
+// swept over grid sizes and number of fields. The field pool is swept over
+// the fields of its contexts (one field, or all the fields of a context per
+// operation), the repositories over synthetic repo infos.
+//
+// Results are written to stdout as CSV, one line per measurement:
+//   benchmark,fields,nx,ny,nz,mode,ns_per_op
+//
+// usage: bench_field_pool [min time per measurement in seconds]
+
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include "../field_pool.hpp"
+
+namespace {
+
+double g_min_time = 0.1;
+
+// prevents the compiler from optimizing away the computation of value, and
+// from caching memory across calls
+template <typename T> inline void do_not_optimize(T const &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// runs f repeatedly, doubling the number of iterations until the
+// measurement lasts at least g_min_time, and returns the time per call
+template <typename F> double ns_per_op(F &&f) {
+  const unsigned long max_iterations = 1ul << 32;
+  unsigned long iterations = 1;
+  while (true) {
+    unsigned long valid = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; ++i) {
+      const bool res = f();
+      do_not_optimize(res);
+      valid += res;
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (valid != iterations)
+      throw(std::runtime_error("Invalid storage returned"));
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+    if (elapsed >= g_min_time || iterations >= max_iterations)
+      return elapsed * 1e9 / iterations;
+    iterations *= 2;
+  }
+}
+
+void report(std::string const &name, unsigned int fields,
+            grid_descriptor const &grid, std::string const &mode,
+            double ns) {
+  std::cout << name << "," << fields << "," << grid.nx() << "," << grid.ny()
+            << "," << grid.nz() << "," << mode << "," << ns << std::endl;
+}
+
+std::string mode_name(allocation_mode mode) {
+  switch (mode) {
+  case allocation_mode::per_field:
+    return "per_field";
+  case allocation_mode::arena:
+    return "arena";
+  default:
+    return "arena_huge_pages";
+  }
+}
+
+// synthetic repository info with N 3d fields and one 2d field
+enum class bench_param {};
+
+template <typename Seq> struct bench_repo_info_impl;
+
+template <std::size_t... Is>
+struct bench_repo_info_impl<index_sequence<Is...>> {
+  using type = repo_info<
+      fields<data_store_3d_t, bench_param, static_cast<bench_param>(Is)...>,
+      fields<data_store_2d_t, bench_param,
+             static_cast<bench_param>(sizeof...(Is))>>;
+};
+
+template <int N> struct bench_repo_info {
+  using type = typename bench_repo_info_impl<make_index_sequence<N>>::type;
+};
+
+template <int N>
+void bench_repository(grid_descriptor const &grid, allocation_mode mode) {
+  using repo_t = repository<bench_param, typename bench_repo_info<N>::type>;
+  const storage_infos_t sinfos = make_storage_infos(grid);
+
+  report("repository_construct", N + 1, grid, mode_name(mode),
+         ns_per_op([&]() {
+           repo_t repo(sinfos, mode);
+           return !repo.is_allocated();
+         }));
+
+  repo_t repo(sinfos, mode);
+  report("repository_allocate", N + 1, grid, mode_name(mode),
+         ns_per_op([&]() {
+           repo.allocate();
+           const bool valid = repo.is_allocated();
+           repo.release();
+           return valid;
+         }));
+
+  repo.allocate();
+  report("repository_get_st", N + 1, grid, mode_name(mode), ns_per_op([&]() {
+           return repo.template get_st<static_cast<bench_param>(N - 1)>()
+               .valid();
+         }));
+}
+
+// number of storages of the repository of a context
+template <typename EnumT> constexpr unsigned int context_fields() {
+  return std::tuple_element<field_pool::context_pos<EnumT>::value,
+                            field_pool::tuple_t>::type::num_fields;
+}
+
+// accesses each time level of each field of a repo info through get_st, and
+// returns the number of valid storages
+template <typename EnumT, std::size_t Level, EnumT... Params>
+unsigned int get_level(field_pool &fpool) {
+  const bool valid[] = {false, fpool.get_st<EnumT, Params, Level>().valid()...};
+  return std::accumulate(valid, valid + sizeof...(Params) + 1, 0u);
+}
+
+template <typename DataStore, typename EnumT, EnumT... Params,
+          std::size_t... Levels>
+unsigned int get_fields(field_pool &fpool,
+                        fields<DataStore, EnumT, Params...> const &,
+                        index_sequence<Levels...>) {
+  const unsigned int valid[] = {0u,
+                                get_level<EnumT, Levels, Params...>(fpool)...};
+  return std::accumulate(valid, valid + sizeof...(Levels) + 1, 0u);
+}
+
+template <typename... Fields>
+unsigned int get_all_fields(field_pool &fpool, type_list<Fields...>) {
+  const unsigned int valid[] = {
+      0u,
+      get_fields(fpool, Fields(), make_index_sequence<Fields::levels>())...};
+  return std::accumulate(valid, valid + sizeof...(Fields) + 1, 0u);
+}
+
+// get_st of one field, and of all the fields of the context
+template <typename EnumT, EnumT param, typename RepoInfo>
+void bench_get_st(field_pool &fpool, grid_descriptor const &grid,
+                  std::string const &mname) {
+  report("get_st", 1, grid, mname, ns_per_op([&]() {
+           return fpool.get_st<EnumT, param>().valid();
+         }));
+  const unsigned int nfields = context_fields<EnumT>();
+  report("get_st", nfields, grid, mname, ns_per_op([&]() {
+           return get_all_fields(fpool, typename RepoInfo::fields_list_t()) ==
+                  nfields;
+         }));
+}
+
+// bind_arg of one field, and of all the fields of the context, to the
+// storages they are already bound to
+template <typename EnumT, EnumT param, typename RepoInfo>
+void bench_bind_arg(field_pool &fpool, grid_descriptor const &grid,
+                    std::string const &mname) {
+  auto &st = fpool.get_st<EnumT, param>();
+  report("bind_arg", 1, grid, mname, ns_per_op([&]() {
+           return fpool.bind_arg<EnumT, param>(st) != 0;
+         }));
+  report("bind_arg", context_fields<EnumT>(), grid, mname, ns_per_op([&]() {
+           fpool.bind_all_args<RepoInfo>();
+           return true;
+         }));
+}
+
+void bench_field_pool(grid_descriptor const &grid, allocation_mode mode) {
+  field_pool fpool(grid, mode);
+  const std::string mname = mode_name(mode);
+  const unsigned int fw_fields = context_fields<fast_waves_sc_param>();
+
+  // the fast waves are nested in the dycore, their activation includes the
+  // import of w, a view when the layouts match and a transposition otherwise
+  fpool.activate_context<dycore_param>();
+  report("activate_deactivate", fw_fields, grid, mname, ns_per_op([&]() {
+           fpool.activate_context<fast_waves_sc_param>();
+           const bool active = fpool.is_active<fast_waves_sc_param>();
+           fpool.deactivate_context<fast_waves_sc_param>();
+           return active;
+         }));
+
+  bench_get_st<dycore_param, dycore_param::u, dycore_repo_info_t>(fpool, grid,
+                                                                mname);
+  bench_bind_arg<dycore_param, dycore_param::u, dycore_repo_info_t>(
+      fpool, grid, mname);
+
+  {
+    auto guard = fpool.enter_context<fast_waves_sc_param>();
+    report("get_st_guard", 1, grid, mname, ns_per_op([&]() {
+             return fpool
+                 .get_st<fast_waves_sc_param, fast_waves_sc_param::lgsA>(guard)
+                 .valid();
+           }));
+    bench_get_st<fast_waves_sc_param, fast_waves_sc_param::lgsA,
+                 fw_sc_repo_info_t>(fpool, grid, mname);
+    bench_bind_arg<fast_waves_sc_param, fast_waves_sc_param::lgsA,
+                   fw_sc_repo_info_t>(fpool, grid, mname);
+  }
+
+  report("get_arg", 1, grid, mname, ns_per_op([&]() {
+           auto *arg = &fpool.get_arg<vadvect, vadvect::data>();
+           do_not_optimize(arg);
+           return arg != NULL;
+         }));
+  report("get_scratch", 1, grid, mname, ns_per_op([&]() {
+           auto tmp = fpool.get_scratch<data_store_3d_t>();
+           return tmp.get().valid();
+         }));
+  fpool.deactivate_context<dycore_param>();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 1)
+    g_min_time = std::stod(argv[1]);
+
+  const grid_descriptor grids[] = {grid_descriptor(16, 16, 8, 3),
+                                   grid_descriptor(64, 64, 32, 3),
+                                   grid_descriptor(128, 128, 64, 3)};
+  const allocation_mode modes[] = {allocation_mode::per_field,
+                                   allocation_mode::arena};
+
+  std::cout << "benchmark,fields,nx,ny,nz,mode,ns_per_op" << std::endl;
+  for (grid_descriptor const &grid : grids) {
+    for (allocation_mode mode : modes) {
+      bench_field_pool(grid, mode);
+      bench_repository<1>(grid, mode);
+      bench_repository<4>(grid, mode);
+      bench_repository<16>(grid, mode);
+    }
+  }
+}
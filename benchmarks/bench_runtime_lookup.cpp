@@ -0,0 +1,90 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+// Compares the cost of accessing a storage through the compile time
+// repository (enum), and through the runtime repository, either by name
+// (perfect hash lookup) or by a field_id obtained at setup.
+//
+// usage: bench_runtime_lookup [iterations [runtime fields]]
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "../field_pool.hpp"
+
+template <typename F> double time_per_call(unsigned int iterations, F &&f) {
+  auto start = std::chrono::steady_clock::now();
+  unsigned int valid = 0;
+  for (unsigned int i = 0; i < iterations; ++i)
+    valid += f();
+  auto end = std::chrono::steady_clock::now();
+  if (valid != iterations)
+    throw(std::runtime_error("Invalid storage returned"));
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         iterations;
+}
+
+int main(int argc, char **argv) {
+  const unsigned int iterations = (argc > 1) ? std::stoi(argv[1]) : 10000000;
+  const unsigned int nfields = (argc > 2) ? std::stoi(argv[2]) : 100;
+
+  field_pool &fpool = field_pool::initialize(grid_descriptor(8, 8, 8));
+
+  for (unsigned int i = 0; i < nfields; ++i)
+    fpool.register_field<dycore_param, data_store_3d_t>("field_" +
+                                                        std::to_string(i));
+  const std::string name = "field_" + std::to_string(nfields / 2);
+  const field_id id = fpool.get_field_id(name);
+
+  fpool.activate_context<dycore_param>();
+
+  const double t_enum = time_per_call(iterations, [&]() {
+    return fpool.get_st<dycore_param, dycore_param::u>().valid();
+  });
+  const double t_id = time_per_call(iterations, [&]() {
+    return fpool.get_st<data_store_3d_t>(id).valid();
+  });
+  const double t_name = time_per_call(iterations, [&]() {
+    return fpool.get_st<data_store_3d_t>(name).valid();
+  });
+
+  fpool.deactivate_context<dycore_param>();
+
+  std::cout << "runtime fields: " << nfields << std::endl;
+  std::cout << "get_st enum:     " << t_enum << " ns" << std::endl;
+  std::cout << "get_st field_id: " << t_id << " ns" << std::endl;
+  std::cout << "get_st name:     " << t_name << " ns" << std::endl;
+}
@@ -0,0 +1,154 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+// Measures when transposing a field to the layout of the column operators
+// pays off:
+//  - transpose: cache-blocked copy of a 3d field from the i contiguous
+//    layout to the k contiguous one (transpose_copy)
+//  - copy: the same copy between two i contiguous fields, the lower bound
+//    of the transposition
+//  - sweep_i, sweep_k: a recurrence along each column, as in the vertical
+//    implicit solvers, on the i contiguous and the k contiguous layouts
+//  - break_even: the number of sweeps per context activation above which
+//    transposing the field in and back is cheaper than sweeping it in the
+//    i contiguous layout (inf if the sweeps are not faster along k)
+//
+// Results are written to stdout as CSV, one line per measurement:
+//   benchmark,nx,ny,nz,ns_per_op
+//
+// usage: bench_transpose [min time per measurement in seconds]
+
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "../transpose.hpp"
+
+namespace {
+
+double g_min_time = 0.1;
+
+// prevents the compiler from optimizing away the computation of value, and
+// from caching memory across calls
+template <typename T> inline void do_not_optimize(T const &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// runs f repeatedly, doubling the number of iterations until the
+// measurement lasts at least g_min_time, and returns the time per call
+template <typename F> double ns_per_op(F &&f) {
+  unsigned long iterations = 1;
+  while (true) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; ++i)
+      f();
+    auto end = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+    if (elapsed >= g_min_time)
+      return elapsed * 1e9 / iterations;
+    iterations *= 2;
+  }
+}
+
+void report(std::string const &name, grid_descriptor const &grid,
+            double ns) {
+  std::cout << name << "," << grid.nx() << "," << grid.ny() << ","
+            << grid.nz() << "," << ns << std::endl;
+}
+
+// forward recurrence along each column, the columns in the order of the
+// solvers (i fastest)
+void sweep(double *field, strides_t const &strides, shape_t const &shape) {
+  const long ni = shape[0], nj = shape[1], nk = shape[2];
+#pragma omp parallel for schedule(static)
+  for (long j = 0; j < nj; ++j)
+    for (long i = 0; i < ni; ++i) {
+      double *column = field + i * strides[0] + j * strides[1];
+      double acc = 0;
+      for (long k = 0; k < nk; ++k) {
+        acc = 0.5 * acc + column[k * strides[2]];
+        column[k * strides[2]] = acc;
+      }
+    }
+  do_not_optimize(field[0]);
+}
+
+void bench_transpose(grid_descriptor const &grid) {
+  const shape_t shape = {{grid.isize(), grid.jsize(), grid.ksize()}};
+  const strides_t i_strides = {{1, shape[0], (long)shape[0] * shape[1]}};
+  const strides_t k_strides = {{(long)shape[1] * shape[2], shape[2], 1}};
+  const std::size_t size = (std::size_t)shape[0] * shape[1] * shape[2];
+  std::vector<double> a(size, 1.0), b(size, 0.0);
+  char const *src = reinterpret_cast<char const *>(a.data());
+  char *dst = reinterpret_cast<char *>(b.data());
+
+  const double transpose = ns_per_op([&]() {
+    transpose_copy(src, i_strides, dst, k_strides, shape, sizeof(double));
+    do_not_optimize(b[0]);
+  });
+  report("transpose", grid, transpose);
+  report("copy", grid, ns_per_op([&]() {
+           transpose_copy(src, i_strides, dst, i_strides, shape,
+                          sizeof(double));
+           do_not_optimize(b[0]);
+         }));
+
+  const double sweep_i =
+      ns_per_op([&]() { sweep(a.data(), i_strides, shape); });
+  const double sweep_k =
+      ns_per_op([&]() { sweep(b.data(), k_strides, shape); });
+  report("sweep_i", grid, sweep_i);
+  report("sweep_k", grid, sweep_k);
+  report("break_even", grid,
+         sweep_k < sweep_i ? 2 * transpose / (sweep_i - sweep_k)
+                           : std::numeric_limits<double>::infinity());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 1)
+    g_min_time = std::stod(argv[1]);
+
+  const grid_descriptor grids[] = {grid_descriptor(64, 64, 60, 3),
+                                   grid_descriptor(128, 128, 80, 3),
+                                   grid_descriptor(256, 256, 80, 3)};
+
+  std::cout << "benchmark,nx,ny,nz,ns_per_op" << std::endl;
+  for (grid_descriptor const &grid : grids)
+    bench_transpose(grid);
+}
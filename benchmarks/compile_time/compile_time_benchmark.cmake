@@ -0,0 +1,112 @@
+# Compile time benchmark of the field management layer.
+#
+# Generates translation units with synthetic repository infos of
+# FIELD_COUNTS fields, which instantiate the repository and the placeholder
+# table for every field, compiles each of them and records the compile time
+# and the peak memory of the compiler in OUTPUT_DIR/compile_time.csv. Only
+# the current implementation is measured, there is no Boost.MPL variant of
+# the translation units to compare with.
+#
+# Invoked by the compile_time_benchmark target with
+#   cmake -DCXX=<compiler> -DCXX_FLAGS=<flags> -DINCLUDE_DIRS=<a|b|...>
+#         -DSOURCE_DIR=<repo> -DOUTPUT_DIR=<dir> -P compile_time_benchmark.cmake
+
+if(NOT FIELD_COUNTS)
+    set(FIELD_COUNTS 10 100 500)
+endif()
+
+separate_arguments(flags UNIX_COMMAND "${CXX_FLAGS}")
+string(REPLACE "|" ";" include_dirs "${INCLUDE_DIRS}")
+set(include_flags "-I${SOURCE_DIR}")
+foreach(dir ${include_dirs})
+    list(APPEND include_flags "-I${dir}")
+endforeach()
+
+# peak memory is only available through GNU time
+find_program(GNU_TIME time PATHS /usr/bin /bin NO_DEFAULT_PATH)
+
+# sub-second timestamps are only available with CMake >= 3.23
+if(CMAKE_VERSION VERSION_LESS 3.23)
+    set(timestamp_format "%s")
+else()
+    set(timestamp_format "%s.%f")
+endif()
+
+file(MAKE_DIRECTORY "${OUTPUT_DIR}")
+set(csv "${OUTPUT_DIR}/compile_time.csv")
+file(WRITE "${csv}" "fields,seconds,max_rss_kb\n")
+
+foreach(n ${FIELD_COUNTS})
+    math(EXPR last "${n} - 1")
+    set(enum_values "")
+    set(params "")
+    set(calls "")
+    foreach(i RANGE ${last})
+        set(enum_values "${enum_values}  f${i},\n")
+        set(params "${params},\n           synthetic_param::f${i}")
+        set(calls "${calls}  res += repo.get_st<synthetic_param::f${i}>().valid();\n")
+        set(calls "${calls}  res += &args_t::get<synthetic_param, synthetic_param::f${i}>(args) == nullptr;\n")
+    endforeach()
+
+    set(source "${OUTPUT_DIR}/synthetic_${n}.cpp")
+    file(WRITE "${source}"
+"// generated by compile_time_benchmark.cmake, do not edit
+#include \"field_pool.hpp\"
+
+enum class synthetic_param {
+${enum_values}};
+
+using synthetic_repo_info_t =
+    repo_info<fields<data_store_3d_t, synthetic_param${params}>>;
+
+using repo_t = repository<synthetic_param, synthetic_repo_info_t>;
+using args_t = arg_table<synthetic_repo_info_t>;
+
+int touch_all(repo_t &repo, args_t::args_tuple_t &args) {
+  int res = 0;
+${calls}  return res;
+}
+")
+
+    set(object "${OUTPUT_DIR}/synthetic_${n}.o")
+    set(compile ${CXX} ${flags} ${include_flags} -c "${source}" -o "${object}")
+    set(rss_file "${OUTPUT_DIR}/synthetic_${n}.rss")
+
+    string(TIMESTAMP start "${timestamp_format}" UTC)
+    if(GNU_TIME)
+        execute_process(COMMAND ${GNU_TIME} -f "%M" -o "${rss_file}" ${compile}
+                        RESULT_VARIABLE result)
+    else()
+        execute_process(COMMAND ${compile} RESULT_VARIABLE result)
+    endif()
+    string(TIMESTAMP end "${timestamp_format}" UTC)
+
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Compilation of ${source} failed")
+    endif()
+
+    # math(EXPR) only handles integers, the elapsed time is computed in us
+    string(REPLACE "." "" start_us "${start}")
+    string(REPLACE "." "" end_us "${end}")
+    math(EXPR elapsed_us "${end_us} - ${start_us}")
+    if(CMAKE_VERSION VERSION_LESS 3.23)
+        math(EXPR elapsed_us "${elapsed_us} * 1000000")
+    endif()
+    math(EXPR seconds "${elapsed_us} / 1000000")
+    math(EXPR fraction "(${elapsed_us} % 1000000) / 1000")
+    string(LENGTH "${fraction}" len)
+    while(len LESS 3)
+        set(fraction "0${fraction}")
+        string(LENGTH "${fraction}" len)
+    endwhile()
+
+    set(max_rss "NA")
+    if(GNU_TIME AND EXISTS "${rss_file}")
+        file(STRINGS "${rss_file}" max_rss LIMIT_COUNT 1)
+    endif()
+
+    message(STATUS "${n} fields: ${seconds}.${fraction} s, ${max_rss} kB")
+    file(APPEND "${csv}" "${n},${seconds}.${fraction},${max_rss}\n")
+endforeach()
+
+message(STATUS "Results written to ${csv}")
@@ -0,0 +1,179 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#include "checkpoint.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stencil-composition/stencil-composition.hpp>
+
+namespace {
+
+const char checkpoint_magic[8] = {'F', 'P', 'O', 'O', 'L', 'C', 'K', '\0'};
+const std::uint32_t checkpoint_version = 3;
+
+std::runtime_error io_error(std::string const &what, std::string const &path) {
+  return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// writes bytes at offset, retrying on partial writes
+bool write_all(int fd, char const *data, std::size_t bytes,
+               std::size_t offset) {
+  while (bytes) {
+    const ssize_t res = pwrite(fd, data, bytes, offset);
+    if (res < 0 && errno == EINTR)
+      continue;
+    if (res <= 0)
+      return false;
+    data += res;
+    bytes -= res;
+    offset += res;
+  }
+  return true;
+}
+
+bool read_all(int fd, char *data, std::size_t bytes, std::size_t offset) {
+  while (bytes) {
+    const ssize_t res = pread(fd, data, bytes, offset);
+    if (res < 0 && errno == EINTR)
+      continue;
+    if (res <= 0)
+      return false;
+    data += res;
+    bytes -= res;
+    offset += res;
+  }
+  return true;
+}
+
+} // namespace
+
+bool operator==(checkpoint_entry const &a, checkpoint_entry const &b) {
+  return a.m_context == b.m_context && a.m_kind == b.m_kind &&
+         a.m_param == b.m_param && a.m_shape[0] == b.m_shape[0] &&
+         a.m_shape[1] == b.m_shape[1] && a.m_shape[2] == b.m_shape[2] &&
+         a.m_element_size == b.m_element_size && a.m_offset == b.m_offset &&
+         a.m_bytes == b.m_bytes && a.m_level == b.m_level;
+}
+
+void write_checkpoint(std::string const &path,
+                      std::vector<checkpoint_entry> const &entries,
+                      std::vector<char const *> const &data) {
+  checkpoint_header header;
+  std::memcpy(header.m_magic, checkpoint_magic, sizeof(header.m_magic));
+  header.m_version = checkpoint_version;
+  header.m_float_size = sizeof(gridtools::float_type);
+  header.m_num_entries = entries.size();
+  header.m_data_offset = entries.empty() ? 0 : entries.front().m_offset;
+
+  // header and table are written with a single call
+  std::vector<char> table(sizeof(header) +
+                          entries.size() * sizeof(checkpoint_entry));
+  std::memcpy(table.data(), &header, sizeof(header));
+  if (!entries.empty())
+    std::memcpy(table.data() + sizeof(header), entries.data(),
+                entries.size() * sizeof(checkpoint_entry));
+
+  const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    throw(io_error("Can not create the checkpoint", path));
+
+  bool ok = write_all(fd, table.data(), table.size(), 0);
+  std::size_t end = table.size();
+  for (std::size_t i = 0; ok && i < entries.size(); ++i) {
+    ok = write_all(fd, data[i], entries[i].m_bytes, entries[i].m_offset);
+    end = std::max<std::size_t>(end, entries[i].m_offset + entries[i].m_bytes);
+  }
+  // the last repository is padded to its full arena, so that it can be
+  // mapped as a whole at restart
+  if (ok && !entries.empty())
+    ok = (ftruncate(fd, arena::align_up(end, arena::field_alignment)) == 0);
+  if (close(fd) != 0)
+    ok = false;
+  if (!ok)
+    throw(io_error("Can not write the checkpoint", path));
+}
+
+checkpoint_file::checkpoint_file(std::string const &path)
+    : m_path(path), m_fd(open(path.c_str(), O_RDONLY)) {
+  if (m_fd < 0)
+    throw(io_error("Can not open the checkpoint", path));
+
+  checkpoint_header header;
+  if (!read_all(m_fd, reinterpret_cast<char *>(&header), sizeof(header), 0) ||
+      std::memcmp(header.m_magic, checkpoint_magic, sizeof(header.m_magic)) ||
+      header.m_version != checkpoint_version) {
+    close(m_fd);
+    throw(std::runtime_error("Invalid checkpoint " + path));
+  }
+  if (header.m_float_size != sizeof(gridtools::float_type)) {
+    close(m_fd);
+    throw(std::runtime_error("Checkpoint " + path +
+                             " was written with a different float type"));
+  }
+
+  m_entries.resize(header.m_num_entries);
+  if (!m_entries.empty() &&
+      !read_all(m_fd, reinterpret_cast<char *>(m_entries.data()),
+                m_entries.size() * sizeof(checkpoint_entry),
+                sizeof(header))) {
+    close(m_fd);
+    throw(io_error("Can not read the checkpoint", path));
+  }
+}
+
+checkpoint_file::~checkpoint_file() { close(m_fd); }
+
+std::shared_ptr<arena> checkpoint_file::load(std::size_t offset,
+                                             std::size_t bytes,
+                                             restart_mode mode,
+                                             bool huge_pages) const {
+  if (mode == restart_mode::map)
+    return std::make_shared<arena>(m_fd, offset, bytes);
+
+  std::shared_ptr<arena> ar = std::make_shared<arena>(bytes, huge_pages);
+  ar->read(m_fd, offset, bytes);
+  return ar;
+}
+
+void checkpoint_file::read(arena &ar, std::size_t offset,
+                           std::size_t bytes) const {
+  if (ar.size() < bytes)
+    throw(std::runtime_error("Arena too small for the checkpoint region"));
+  ar.read(m_fd, offset, bytes);
+}
@@ -0,0 +1,115 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "arena.hpp"
+
+/**
+ * Selects how the repositories are restored from a checkpoint file:
+ *  - map: the file is mapped (copy on write) and the fields of each
+ *    repository are placed on top of the mapping, without copying
+ *  - read: the data of each repository is read into a new arena, with
+ *    large aligned reads
+ */
+enum class restart_mode { map, read };
+
+// header of a checkpoint file, followed by the table of entries
+struct checkpoint_header {
+  char m_magic[8];
+  std::uint32_t m_version;
+  std::uint32_t m_float_size;
+  std::uint64_t m_num_entries;
+  // offset of the data of the first field, aligned to the fields
+  std::uint64_t m_data_offset;
+};
+
+// one entry per field. The fields of a repository are stored with the layout
+// of its arena, starting at an offset aligned to arena::field_alignment
+struct checkpoint_entry {
+  std::uint32_t m_context;
+  // position of the storage kind of the field in the repo info
+  std::uint32_t m_kind;
+  std::int64_t m_param;
+  std::uint32_t m_shape[3];
+  std::uint32_t m_element_size;
+  std::uint64_t m_offset;
+  std::uint64_t m_bytes;
+  // time level of the field
+  std::uint32_t m_level;
+  std::uint32_t m_padding;
+};
+
+bool operator==(checkpoint_entry const &a, checkpoint_entry const &b);
+
+/**
+ * Writes the header, the table of entries and the data of each field (one
+ * write per field, at the offset of its entry) to the file path
+ */
+void write_checkpoint(std::string const &path,
+                      std::vector<checkpoint_entry> const &entries,
+                      std::vector<char const *> const &data);
+
+/**
+ * Checkpoint file opened for a restart. The header and the table of entries
+ * are read at construction, and the data of the repositories is mapped or
+ * read on request
+ */
+class checkpoint_file {
+public:
+  explicit checkpoint_file(std::string const &path);
+  ~checkpoint_file();
+
+  checkpoint_file(checkpoint_file const &) = delete;
+  checkpoint_file &operator=(checkpoint_file const &) = delete;
+
+  std::vector<checkpoint_entry> const &entries() const { return m_entries; }
+
+  // region [offset, offset + bytes) of the file as an arena
+  std::shared_ptr<arena> load(std::size_t offset, std::size_t bytes,
+                              restart_mode mode, bool huge_pages) const;
+
+  // reads the region [offset, offset + bytes) of the file into the
+  // beginning of an existing arena
+  void read(arena &ar, std::size_t offset, std::size_t bytes) const;
+
+private:
+  std::string m_path;
+  int m_fd;
+  std::vector<checkpoint_entry> m_entries;
+};
@@ -35,11 +35,59 @@
 */
 
 #include "field_pool.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
 
-field_pool *field_pool::m_field_pool = NULL;
+std::atomic<field_pool *> field_pool::m_field_pool(NULL);
+std::mutex field_pool::m_init_mutex;
+thread_local field_pool *field_pool::m_thread_instance = NULL;
+std::atomic<unsigned int> field_pool::m_num_instances(0);
+
+field_pool &field_pool::initialize(grid_descriptor const &grid,
+                                   allocation_mode mode, context_mode cmode,
+                                   tiling tiles) {
+  std::lock_guard<std::mutex> lock(m_init_mutex);
+  if (m_field_pool.load(std::memory_order_relaxed))
+    throw(std::runtime_error("field_pool is already initialized"));
+  field_pool *fpool = new field_pool(grid, mode, cmode, tiles);
+  m_field_pool.store(fpool, std::memory_order_release);
+  return *fpool;
+}
 
 field_pool &field_pool::get_instance() {
-  if (!m_field_pool)
-    m_field_pool = new field_pool();
-  return *m_field_pool;
+  if (m_thread_instance)
+    return *m_thread_instance;
+  field_pool *fpool = m_field_pool.load(std::memory_order_acquire);
+  if (!fpool)
+    throw(std::runtime_error("field_pool is not initialized"));
+  return *fpool;
+}
+
+void field_pool::write_stats(std::string const &path) const {
+  std::ofstream out(path);
+  stats().write_json(out);
+  out.close();
+  if (!out)
+    throw(std::runtime_error("Can not write the stats to " + path));
+}
+
+namespace {
+std::string g_stats_path;
+
+void write_stats_of_instance() {
+  // exceptions can not leave an exit handler
+  try {
+    field_pool::get_instance().write_stats(g_stats_path);
+  } catch (std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+  }
+}
+}
+
+void field_pool::write_stats_at_exit(std::string const &path) {
+  std::lock_guard<std::mutex> lock(m_init_mutex);
+  if (g_stats_path.empty())
+    std::atexit(write_stats_of_instance);
+  g_stats_path = path;
 }
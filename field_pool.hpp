@@ -35,170 +35,1611 @@
 */
 
 #pragma once
-#include <boost/mpl/set_c.hpp>
-#include <boost/mpl/map.hpp>
-#include <boost/mpl/at.hpp>
-#include <boost/type_traits/is_same.hpp>
+#include <array>
 #include <map>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
 #include "param_definitions.hpp"
+#include "grid_descriptor.hpp"
 #include "repository.hpp"
+#include "runtime_repository.hpp"
+#include "tracer_bundle.hpp"
+#include "output_stage.hpp"
+#include "pool_stats.hpp"
+#include "trace.hpp"
+#include "tile.hpp"
+#include "halo_exchange.hpp"
+#include "transpose.hpp"
+#include "scratch_pool.hpp"
 
-#define ARG(data_store) gridtools::arg<__COUNTER__, data_store>
+// position of a time level of a field (param of the context EnumT) in a
+// flat list of fields lists, -1 if the field or the level is not found
+template <typename EnumT>
+constexpr int arg_position(type_list<>, EnumT, int, unsigned int = 0) {
+  return -1;
+}
 
-template <typename Variadic, typename T> struct variadic_concat;
+template <typename EnumT, typename F, typename... Fs>
+constexpr int arg_position(type_list<F, Fs...>, EnumT param, int offset,
+                           unsigned int level = 0) {
+  return (std::is_same<typename F::enum_t, EnumT>::value &&
+          F::contains(static_cast<typename F::enum_t>((long)param)))
+             ? (level < F::levels
+                    ? offset + level * F::size +
+                          F::position(
+                              static_cast<typename F::enum_t>((long)param))
+                    : -1)
+             : arg_position(type_list<Fs...>(), param,
+                            offset + F::size * F::levels, level);
+}
 
-template <typename T, typename... Vars>
-struct variadic_concat<gridtools::variadic_typedef<Vars...>, T> {
-  using type = gridtools::variadic_typedef<Vars..., T>;
+template <typename DataStores, typename Seq> struct make_args_tuple;
+
+template <typename... DataStores, std::size_t... Is>
+struct make_args_tuple<type_list<DataStores...>, index_sequence<Is...>> {
+  using type = indexed_tuple<gridtools::arg<Is, DataStores>...>;
 };
 
-template <typename Variadic> struct variadic_to_tuple;
+/**
+ * Flat table of the placeholders of all the fields of a list of repo infos.
+ * The placeholder of the i-th field of the table is
+ * gridtools::arg<i, data_store_t>, each time level of a field having its own
+ * placeholder. Fields that appear in several lists of a repo info are mapped
+ * to their first occurrence
+ */
+template <typename... RepoInfos> struct arg_table {
+  using fields_list_t =
+      typename concat_lists<typename RepoInfos::fields_list_t...>::type;
+
+  template <typename List> struct data_stores;
+  template <typename... Fields> struct data_stores<type_list<Fields...>> {
+    using type = typename concat_lists<
+        repeat_type<typename Fields::data_store_t,
+                    Fields::size * Fields::levels>...>::type;
+  };
+  using data_stores_t = typename data_stores<fields_list_t>::type;
+
+  static constexpr unsigned int size = data_stores_t::size;
+
+  using args_tuple_t =
+      typename make_args_tuple<data_stores_t,
+                               make_index_sequence<data_stores_t::size>>::type;
+
+  template <typename EnumT, EnumT param, unsigned int level = 0>
+  struct index
+      : std::integral_constant<int, arg_position(fields_list_t(), param, 0,
+                                                 level)> {};
+
+  // unknown fields are mapped to the first placeholder in the return type,
+  // so that the static assert below reports the error
+  template <typename EnumT, EnumT param, unsigned int level = 0>
+  static auto get(args_tuple_t &args) -> decltype(get_element<(
+      index<EnumT, param, level>::value >= 0 ? index<EnumT, param, level>::value
+                                             : 0)>(args)) {
+    GRIDTOOLS_STATIC_ASSERT((index<EnumT, param, level>::value >= 0),
+                            "Error");
 
-template <typename... Vars>
-struct variadic_to_tuple<gridtools::variadic_typedef<Vars...>> {
-  using type = std::tuple<Vars...>;
+    return get_element<index<EnumT, param, level>::value>(args);
+  }
 };
 
-template <typename Map> struct map_to_tuple {
+// storage a placeholder is bound to. The fields are atomic, so that a
+// binding to the same storage is checked without taking the lock
+struct arg_binding {
+  std::atomic<void const *> m_storage{nullptr};
+  // number of times the placeholder was bound to a different storage
+  std::atomic<unsigned long> m_generation{0};
+  // number of calls to bind_arg
+  std::atomic<unsigned long> m_binds{0};
+};
 
-  template <typename Variadic, typename Pair> struct insert {
-    using type =
-        typename variadic_concat<Variadic,
-                                 typename boost::mpl::second<Pair>::type>::type;
-  };
+// constructs a tuple of repositories, passing the same arguments to the
+// constructor of each repository
+template <typename Tuple> struct make_repos;
 
-  using vt_t =
-      typename boost::mpl::fold<Map, gridtools::variadic_typedef<>,
-                                insert<boost::mpl::_1, boost::mpl::_2>>::type;
+template <typename... Repos> struct make_repos<std::tuple<Repos...>> {
+  template <typename... Args>
+  static std::tuple<Repos...> apply(Args const &... args) {
+    return std::tuple<Repos...>(Repos(args...)...);
+  }
+};
 
-  using type = typename variadic_to_tuple<vt_t>::type;
+// peak memory footprint of the repositories (in bytes), assuming all the
+// contexts that are not declared as aliased can be active at the same time.
+// The constant fields are not included, since they are held once for all
+// the instances that share them
+struct memory_plan {
+  std::size_t m_unaliased_peak;
+  std::size_t m_aliased_peak;
+  std::size_t m_constant_bytes;
 };
 
+inline std::ostream &operator<<(std::ostream &os, memory_plan const &plan) {
+  return os << "peak footprint: " << plan.m_unaliased_peak
+            << " bytes without aliasing, " << plan.m_aliased_peak
+            << " bytes with aliasing, " << plan.m_constant_bytes
+            << " bytes of shared constant fields";
+}
+
+#ifndef FIELD_POOL_CHECK_CONTEXT
+#ifdef NDEBUG
+#define FIELD_POOL_CHECK_CONTEXT 0
+#else
+#define FIELD_POOL_CHECK_CONTEXT 1
+#endif
+#endif
+
+// calls to get_st are only counted if FIELD_POOL_STATS is set, since the
+// counters are shared by all the threads accessing the storages
+#ifndef FIELD_POOL_STATS
+#define FIELD_POOL_STATS 0
+#endif
+
+template <typename... Contexts> class context_guard;
+
+// whether the active contexts are shared by all the threads, or each thread
+// activates and deactivates contexts independently
+enum class context_mode { shared, per_thread };
+
 struct field_pool {
 
   using tuple_t =
       std::tuple<repository<dycore_param, dycore_repo_info_t>,
-                 repository<fast_waves_sc_param, fw_sc_repo_info_t>>;
+                 repository<fast_waves_sc_param, fw_sc_repo_info_t>,
+                 repository<hdiff_param, hdiff_repo_info_t>>;
 
-  using context_list_t = boost::mpl::vector<dycore_param, fast_waves_sc_param>;
+  using context_list_t =
+      type_list<dycore_param, fast_waves_sc_param, hdiff_param>;
 
-  template <typename... Cont> struct build_arg_map {
+  static constexpr unsigned int num_contexts = context_list_t::size;
 
-    template <typename Map, typename Key, typename data_store_t>
-    struct insert_key {
-      using type = typename boost::mpl::insert<
-          Map, boost::mpl::pair<Key, ARG(data_store_t)>>::type;
-    };
+  template <typename EnumT>
+  struct context_pos : index_of<EnumT, context_list_t> {};
 
-    template <typename Map, typename DPPair> struct insert_in_map {
-      using enum_seq = typename boost::mpl::second<DPPair>::type;
-      using data_store_t = typename boost::mpl::first<DPPair>::type;
-      using enum_type = typename enum_seq::value_type;
+  // names of the contexts in the reports
+  static char const *context_name(unsigned int pos) {
+    static char const *names[] = {"dycore", "fast_waves_sc", "hdiff"};
+    return names[pos];
+  }
 
-      using type = typename boost::mpl::fold<
-          enum_seq, Map,
-          insert_key<boost::mpl::_1, boost::mpl::_2, data_store_t>>::type;
-    };
+  using args_table_t =
+      arg_table<dycore_repo_info_t, fw_sc_repo_info_t, hdiff_repo_info_t,
+                list_vadvect_params, list_vadvect_batch_params>;
+
+  using args_tuple_t = typename args_table_t::args_tuple_t;
+
+private:
+  static std::atomic<field_pool *> m_field_pool;
+  static std::mutex m_init_mutex;
+  // instance returned by get_instance() in the calling thread, if set by an
+  // instance_scope
+  static thread_local field_pool *m_thread_instance;
+  static std::atomic<unsigned int> m_num_instances;
 
-    template <typename Map, typename MapDP> struct insert {
-      using type = typename boost::mpl::fold<
-          MapDP, Map, insert_in_map<boost::mpl::_1, boost::mpl::_2>>::type;
-    };
+  // index of the instance among all the instances created in the process
+  const unsigned int m_instance_id;
 
-    using type =
-        typename boost::mpl::fold<boost::mpl::vector<Cont...>,
-                                  boost::mpl::map0<>,
-                                  insert<boost::mpl::_1, boost::mpl::_2>>::type;
+  grid_descriptor m_grid;
+  // one storage info per shape, shared by all the fields of that shape
+  storage_infos_t m_sinfos;
+  tuple_t m_repos;
+  runtime_repository m_runtime_repo;
+  // one tracer bundle per context
+  std::vector<tracer_bundle> m_tracers;
+
+  // storages of a tile, with the storage infos of the grid of the tile. The
+  // repositories refer to the storage infos, therefore tiles do not move.
+  // The tiles own the memory of the fields of a split domain, the
+  // repositories of the whole domain are then never allocated
+  struct tile_storage {
+    tile_descriptor m_descriptor;
+    storage_infos_t m_sinfos;
+    tuple_t m_repos;
+    tile_storage(tile_descriptor const &desc, allocation_mode mode)
+        : m_descriptor(desc), m_sinfos(make_storage_infos(desc.m_grid)),
+          m_repos(make_repos<tuple_t>::apply(m_sinfos, mode)) {}
   };
+  tiling m_tiling;
+  std::vector<tile_descriptor> m_tile_descriptors;
+  // empty if the domain is not split
+  std::vector<std::unique_ptr<tile_storage>> m_tiles;
+
+  bool split() const { return !m_tiles.empty(); }
+  // number of activations of each context, protected by m_mutex, and the
+  // mask of active contexts, that can be read without locking
+  std::array<unsigned int, num_contexts> m_active_context;
+  std::atomic<unsigned long long> m_active_mask;
+  context_mode m_context_mode;
+  // serializes the activation of contexts and the registration of fields
+  mutable std::mutex m_mutex;
+  // the placeholders and their bindings are changed under m_bind_mutex, that
+  // is taken after m_mutex when both are needed
+  mutable std::mutex m_bind_mutex;
+  args_tuple_t m_args_tuple;
+  std::array<arg_binding, args_table_t::size> m_arg_bindings;
 
-  using args_t = typename build_arg_map<dycore_repo_info_t, fw_sc_repo_info_t,
-                                        list_vadvect_params>::type;
+  allocation_mode m_mode;
+  // alias group of each context (-1 if it is not aliased). All the contexts
+  // of a group share the same arena, and only one of them can be active.
+  // The arena is only allocated while one of them is active
+  std::array<int, num_contexts> m_alias_group;
+  std::vector<std::shared_ptr<arena>> m_alias_arenas;
+  std::unique_ptr<output_stage> m_output;
+  // memory of the temporaries of the operators
+  scratch_pool m_scratch;
 
-  using args_tuple_t = typename map_to_tuple<args_t>::type;
+  // accounting of the memory and of the activations of the contexts,
+  // protected by m_mutex
+  std::array<unsigned long, num_contexts> m_activations;
+  std::array<context_timer, num_contexts> m_active_time;
+  std::array<std::size_t, num_contexts> m_current_bytes;
+  std::array<std::size_t, num_contexts> m_peak_bytes;
+  std::size_t m_total_bytes;
+  std::size_t m_total_peak_bytes;
+  // get_st calls of each field, the fields of the context i start at
+  // m_field_offset[i]
+  std::array<unsigned int, num_contexts> m_field_offset;
+  std::vector<std::atomic<unsigned long>> m_get_st_calls;
 
-  template <typename HMap, typename Pair> struct insert_nindex {
-    using index_t = typename boost::mpl::first<HMap>::type;
-    using map_t = typename boost::mpl::second<HMap>::type;
+  template <typename EnumT, EnumT param, unsigned int level = 0>
+  void count_get_st() {
+    constexpr unsigned int pos = context_pos<EnumT>::value;
+    m_get_st_calls[m_field_offset[pos] +
+                   std::tuple_element<pos, tuple_t>::type::template field_index<
+                       param, level>::value]
+        .fetch_add(1, std::memory_order_relaxed);
+  }
 
-    using indexpt_t = boost::mpl::integral_c<int, index_t::value + 1>;
-    using type = boost::mpl::pair<
-        indexpt_t,
-        typename boost::mpl::insert<
-            map_t, boost::mpl::pair<typename boost::mpl::first<Pair>::type,
-                                    indexpt_t>>::type>;
+  template <typename DataStore, typename EnumT, EnumT... Params>
+  void bind_fields(fields<DataStore, EnumT, Params...>) {
+    int expand[] = {
+        0, (bind_arg<EnumT, Params>(get_st<EnumT, Params>()), 0)...};
+    (void)expand;
+  }
+
+  // binds the placeholders of all the time levels of the fields. If
+  // bound_only is set, only the placeholders that were already bound are
+  // rebound (after a rotation of the time levels)
+  template <unsigned int Levels, typename DataStore, typename EnumT,
+            EnumT... Params>
+  void bind_fields(time_levels<Levels, fields<DataStore, EnumT, Params...>>,
+                   bool bound_only = false) {
+    bind_levels<EnumT, Params...>(make_index_sequence<Levels>(), bound_only);
+  }
+
+  template <typename EnumT, EnumT... Params, std::size_t... Levels>
+  void bind_levels(index_sequence<Levels...>, bool bound_only) {
+    int expand[] = {0,
+                    (bind_level<EnumT, Levels, Params...>(bound_only), 0)...};
+    (void)expand;
+  }
+
+  template <typename EnumT, unsigned int level, EnumT... Params>
+  void bind_level(bool bound_only) {
+    int expand[] = {
+        0, ((bound_only && arg_generation<EnumT, Params, level>() == 0)
+                ? 0
+                : bind_arg<EnumT, Params, level>(
+                      get_st<EnumT, Params, level>()),
+            0)...};
+    (void)expand;
+  }
+
+  // the placeholders of the fields with a single time level are not changed
+  // by a rotation
+  template <typename DataStore, typename EnumT, EnumT... Params>
+  void rebind_levels(fields<DataStore, EnumT, Params...>) {}
+
+  template <unsigned int Levels, typename Fields>
+  void rebind_levels(time_levels<Levels, Fields> levels) {
+    bind_fields(levels, true);
+  }
+
+  template <typename... Fields>
+  void rebind_levels_list(type_list<Fields...>) {
+    int expand[] = {0, (rebind_levels(Fields()), 0)...};
+    (void)expand;
+  }
+
+  template <typename... Fields> void bind_fields_list(type_list<Fields...>) {
+    int expand[] = {0, (bind_fields(Fields()), 0)...};
+    (void)expand;
+  }
+
+  // whether the contexts of the imported fields of a context are active
+  template <typename... Imports>
+  bool import_sources_active(type_list<Imports...>) const {
+    bool active[] = {
+        true,
+        (m_active_context[context_pos<
+             typename Imports::source_enum_t>::value] != 0)...};
+    return std::all_of(active, active + sizeof...(Imports) + 1,
+                       [](bool a) { return a; });
+  }
+
+  template <typename... Imports>
+  static bool imports_from(type_list<Imports...>, unsigned int pos) {
+    bool from[] = {
+        false,
+        (context_pos<typename Imports::source_enum_t>::value == pos)...};
+    return std::any_of(from, from + sizeof...(Imports) + 1,
+                       [](bool f) { return f; });
+  }
+
+  // whether the context Inner is nested in any of the contexts
+  template <typename Inner, typename... Outers> struct nested_in_any {
+    static constexpr bool value =
+        first_true(0, nested_context<Inner, Outers>::value...) >= 0;
   };
 
-  using args_to_index_ht = typename boost::mpl::fold<
-      args_t,
-      boost::mpl::pair<boost::mpl::integral_c<int, -1>, boost::mpl::map0<>>,
-      insert_nindex<boost::mpl::_1, boost::mpl::_2>>::type;
+  // finds the active contexts that import fields from the context pos
+  struct find_importers {
+    field_pool const &m_pool;
+    unsigned int m_pos;
+    bool &m_found;
+    find_importers(field_pool const &pool, unsigned int pos, bool &found)
+        : m_pool(pool), m_pos(pos), m_found(found) {}
+    template <typename Index> void operator()(Index const &) {
+      using enum_t = typename type_at<Index::value, context_list_t>::type;
+      if (m_pool.m_active_context[Index::value] &&
+          imports_from(typename context_imports<enum_t>::type(), m_pos))
+        m_found = true;
+    }
+  };
 
-  using args_to_index_t = typename boost::mpl::second<args_to_index_ht>::type;
+  // copies the imported fields from their context (in), or back to it. If
+  // the layouts are the same (i.e. the column layout on the host), the
+  // imported field is a view of the field of its context, and nothing is
+  // copied. If copy is not set, only the views are set up
+  template <typename Import>
+  static void transfer_field(tuple_t &repos, bool in, bool copy) {
+    auto &src = std::get<context_pos<typename Import::source_enum_t>::value>(
+                    repos)
+                    .template get_st<Import::source_param>();
+    auto &dst_repo =
+        std::get<context_pos<typename Import::enum_t>::value>(repos);
+    using dst_repo_t = typename std::decay<decltype(dst_repo)>::type;
+    auto &dst = dst_repo.template get_st<Import::param>();
+    using src_t = typename std::decay<decltype(src)>::type;
+    using dst_t = typename std::decay<decltype(dst)>::type;
+    if (same_layout<typename src_t::storage_info_t,
+                    typename dst_t::storage_info_t>::value) {
+      if (in)
+        dst = view_of<dst_t>(
+            src, dst_repo.template storage_info<
+                     dst_repo_t::template param_kind<Import::param>::value>());
+      return;
+    }
+    if (!copy)
+      return;
+    if (in)
+      transpose_field(src, dst);
+    else if (Import::mode == import_mode::in_out)
+      transpose_field(dst, src);
+  }
 
-  using args_vector_t = typename boost::mpl::fold<
-      args_t, boost::mpl::vector0<>,
-      boost::mpl::push_back<boost::mpl::_1, boost::mpl::_2>>::type;
+  // the fields are imported in the whole domain, or in each of the tiles of
+  // a split domain
+  template <typename... Imports>
+  void transfer_fields(type_list<Imports...>, bool in, bool copy = true) {
+    if (!split()) {
+      int expand[] = {0, (transfer_field<Imports>(m_repos, in, copy), 0)...};
+      (void)expand;
+    }
+    for (auto &tile : m_tiles) {
+      int expand[] = {0,
+                      (transfer_field<Imports>(tile->m_repos, in, copy), 0)...};
+      (void)expand;
+    }
+  }
 
-private:
-  static field_pool *m_field_pool;
+  // bit of each context in the active context masks
+  static unsigned long long context_bit(unsigned int pos) {
+    return 1ull << pos;
+  }
 
-  tuple_t m_repos;
-  std::array<unsigned int, boost::mpl::size<context_list_t>::value>
-      m_active_context;
-  args_tuple_t m_args_tuple;
+  // activation state of the contexts for context_mode::per_thread
+  struct thread_context_state {
+    std::array<unsigned int, num_contexts> m_count;
+    unsigned long long m_mask;
+  };
+
+  // each thread keeps the state of every instance, indexed by the id of the
+  // instance, so that the members of an ensemble nest their contexts
+  // independently
+  thread_context_state &this_thread_state() const {
+    static thread_local std::vector<thread_context_state> states;
+    if (states.size() <= m_instance_id)
+      states.resize(m_instance_id + 1);
+    return states[m_instance_id];
+  }
+
+  bool context_active(unsigned int pos) const {
+    if (m_context_mode == context_mode::per_thread)
+      return this_thread_state().m_mask & context_bit(pos);
+    return m_active_mask.load(std::memory_order_acquire) & context_bit(pos);
+  }
+
+  // increments the number of activations of a context, allocating its
+  // storages on the first one. If any step of the allocation throws, the
+  // storages allocated so far are released in reverse order, and the
+  // context stays inactive
+  template <typename EnumT> void acquire_context() {
+    constexpr unsigned int pos = context_pos<EnumT>::value;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_active_context[pos]) {
+      ++m_active_context[pos];
+      return;
+    }
+    FIELD_POOL_TRACE_SCOPE("memory", "allocate");
+    using imports_t = typename context_imports<EnumT>::type;
+    if (!import_sources_active(imports_t()))
+      throw(std::runtime_error(
+          "Can not activate a context before the contexts it imports from"));
+    // the fields of an aliased context share memory with the other contexts
+    // of its group, that therefore can not be active
+    const int group = m_alias_group[pos];
+    for (unsigned int i = 0; i < num_contexts; ++i)
+      if (group >= 0 && i != pos && m_alias_group[i] == group &&
+          m_active_context[i])
+        throw(std::runtime_error(
+            "Can not activate a context while an aliased context is active"));
+    // the tiles own the memory of the fields of a split domain, the
+    // repository of the whole domain is not allocated
+    if (!split() && group < 0) {
+      std::get<pos>(m_repos).allocate();
+    } else if (!split()) {
+      if (!m_alias_arenas[group]) {
+        auto shared = std::make_shared<arena>(
+            alias_group_size(group),
+            m_mode == allocation_mode::arena_huge_pages);
+        shared->first_touch(0, shared->size());
+        m_alias_arenas[group] = shared;
+        m_total_bytes += shared->size();
+        m_total_peak_bytes = std::max(m_total_peak_bytes, m_total_bytes);
+      }
+      try {
+        std::get<pos>(m_repos).allocate(m_alias_arenas[group]);
+      } catch (...) {
+        release_alias_arena(pos);
+        throw;
+      }
+    }
+    try {
+      allocate_tiles<pos>();
+      m_runtime_repo.allocate(pos);
+      m_tracers[pos].allocate();
+      if (imports_t::size) {
+        FIELD_POOL_TRACE_SCOPE("memory", "import");
+        transfer_fields(imports_t(), true);
+      }
+    } catch (...) {
+      release_storages<pos>();
+      release_alias_arena(pos);
+      throw;
+    }
+    m_active_context[pos] = 1;
+    m_active_mask.fetch_or(context_bit(pos), std::memory_order_release);
+
+    ++m_activations[pos];
+    m_active_time[pos].start();
+    account_context_bytes<pos>(true);
+  }
+
+  // updates the bytes held by a context: the fields of its repositories
+  // (whole domain, or tiles of a split domain), its tracer bundle and its
+  // runtime fields. The
+  // fields of an aliased context are placed in the arena of its group, that
+  // is only counted once in the total
+  template <unsigned int pos> void account_context_bytes(bool active) {
+    const std::size_t repo_bytes =
+        split() ? 0 : std::get<pos>(m_repos).footprint();
+    std::size_t bytes = 0;
+    if (active) {
+      bytes = repo_bytes + m_tracers[pos].footprint() +
+              m_runtime_repo.footprint(pos);
+      for (auto const &tile : m_tiles)
+        bytes += std::get<pos>(tile->m_repos).footprint();
+    }
+    const std::size_t arena_bytes = m_alias_group[pos] < 0 ? 0 : repo_bytes;
+    if (m_current_bytes[pos])
+      m_total_bytes -= m_current_bytes[pos] - arena_bytes;
+    if (bytes)
+      m_total_bytes += bytes - arena_bytes;
+    m_current_bytes[pos] = bytes;
+    m_peak_bytes[pos] = std::max(m_peak_bytes[pos], m_current_bytes[pos]);
+    m_total_peak_bytes = std::max(m_total_peak_bytes, m_total_bytes);
+  }
+
+  // decrements the number of activations of a context, releasing its
+  // storages on the last one
+  template <typename EnumT> void release_context() {
+    constexpr unsigned int pos = context_pos<EnumT>::value;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_active_context[pos])
+      throw(std::runtime_error("Can not deactivate a non active context"));
+    using imports_t = typename context_imports<EnumT>::type;
+    if (m_active_context[pos] == 1) {
+      bool imported = false;
+      for_each_index<num_contexts>(find_importers(*this, pos, imported));
+      if (imported)
+        throw(std::runtime_error("Can not deactivate a context whose fields "
+                                 "are imported by an active context"));
+      if (imports_t::size) {
+        FIELD_POOL_TRACE_SCOPE("memory", "export");
+        transfer_fields(imports_t(), false);
+      }
+    }
+
+    if (--m_active_context[pos] == 0) {
+      FIELD_POOL_TRACE_SCOPE("memory", "release");
+      m_active_mask.fetch_and(~context_bit(pos), std::memory_order_release);
+      unbind_context_args<pos>();
+      release_storages<pos>();
+
+      m_active_time[pos].stop();
+      account_context_bytes<pos>(false);
+      release_alias_arena(pos);
+    }
+  }
+
+  // releases the arena of the alias group of a context when none of the
+  // contexts of the group is active
+  void release_alias_arena(unsigned int pos) {
+    const int group = m_alias_group[pos];
+    if (group < 0 || !m_alias_arenas[group])
+      return;
+    for (unsigned int i = 0; i < num_contexts; ++i)
+      if (m_alias_group[i] == group && m_active_context[i])
+        return;
+    m_total_bytes -= m_alias_arenas[group]->size();
+    m_alias_arenas[group].reset();
+  }
+
+  // releases the storages of a context, in the reverse order of their
+  // allocation. Storages that are not allocated are skipped
+  template <unsigned int pos> void release_storages() {
+    m_tracers[pos].release();
+    m_runtime_repo.release(pos);
+    for (auto &tile : m_tiles)
+      std::get<pos>(tile->m_repos).release();
+    std::get<pos>(m_repos).release();
+  }
+
+  // resets the placeholders bound to any of the (sorted) storages, so that
+  // the released storages are not reachable through get_arg. Their
+  // generation is incremented, so that the computations set up their domain
+  // again
+  struct unbind_args {
+    field_pool &m_pool;
+    std::vector<void const *> const &m_storages;
+    unbind_args(field_pool &pool, std::vector<void const *> const &storages)
+        : m_pool(pool), m_storages(storages) {}
+    template <typename Index> void operator()(Index const &) {
+      arg_binding &binding = m_pool.m_arg_bindings[Index::value];
+      void const *storage = binding.m_storage.load(std::memory_order_relaxed);
+      if (!storage || !std::binary_search(m_storages.begin(),
+                                          m_storages.end(), storage))
+        return;
+      using storage_t = typename type_at<
+          Index::value, typename args_table_t::data_stores_t>::type;
+      get_element<Index::value>(m_pool.m_args_tuple) = storage_t();
+      binding.m_storage.store(nullptr, std::memory_order_relaxed);
+      binding.m_generation.fetch_add(1, std::memory_order_release);
+    }
+  };
+
+  // unbinds the placeholders bound to the storages of a context (of the
+  // whole domain, of the tiles and registered at runtime) before they are
+  // released
+  template <unsigned int pos> void unbind_context_args() {
+    std::vector<void const *> storages;
+    std::get<pos>(m_repos).collect_storages(storages);
+    for (auto const &tile : m_tiles)
+      std::get<pos>(tile->m_repos).collect_storages(storages);
+    m_runtime_repo.collect_storages(pos, storages);
+    unbind_storages(storages);
+  }
+
+  void unbind_storages(std::vector<void const *> &storages) {
+    std::sort(storages.begin(), storages.end());
+    std::lock_guard<std::mutex> lock(m_bind_mutex);
+    for_each_index<args_table_t::size>(unbind_args(*this, storages));
+  }
+
+  struct collect_footprints {
+    tuple_t const &m_repos;
+    std::array<std::size_t, num_contexts> &m_footprints;
+    bool m_constant;
+    collect_footprints(tuple_t const &repos,
+                       std::array<std::size_t, num_contexts> &footprints,
+                       bool constant)
+        : m_repos(repos), m_footprints(footprints), m_constant(constant) {}
+    template <typename Index> void operator()(Index const &) {
+      auto const &repo = std::get<Index::value>(m_repos);
+      m_footprints[Index::value] =
+          m_constant ? repo.constant_footprint() : repo.footprint();
+    }
+  };
+
+  // shares the constant fields of the repositories of each context
+  struct share_repos_constants {
+    tuple_t &m_repos;
+    tuple_t &m_source;
+    share_repos_constants(tuple_t &repos, tuple_t &source)
+        : m_repos(repos), m_source(source) {}
+    template <typename Index> void operator()(Index const &) {
+      std::get<Index::value>(m_repos).share_constants(
+          std::get<Index::value>(m_source));
+    }
+  };
+
+  struct protect_repos_constants {
+    tuple_t &m_repos;
+    bool m_read_only;
+    protect_repos_constants(tuple_t &repos, bool read_only)
+        : m_repos(repos), m_read_only(read_only) {}
+    template <typename Index> void operator()(Index const &) {
+      std::get<Index::value>(m_repos).protect_constants(m_read_only);
+    }
+  };
+
+  // entries (and data) of the repositories of the active contexts in a
+  // checkpoint, each repository starting at an offset aligned to the fields
+  struct collect_checkpoint {
+    tuple_t const &m_repos;
+    std::size_t m_offset;
+    std::vector<checkpoint_entry> &m_entries;
+    std::vector<char const *> *m_data;
+    collect_checkpoint(tuple_t const &repos, std::size_t offset,
+                       std::vector<checkpoint_entry> &entries,
+                       std::vector<char const *> *data)
+        : m_repos(repos), m_offset(offset), m_entries(entries), m_data(data) {}
+    template <typename Index> void operator()(Index const &) {
+      auto const &repo = std::get<Index::value>(m_repos);
+      if (!repo.is_allocated())
+        return;
+      repo.checkpoint_entries(Index::value, m_offset, m_entries, m_data);
+      m_offset += arena::align_up(repo.footprint() + repo.constant_footprint(),
+                                  arena::field_alignment);
+    }
+  };
+
+  // finds the active contexts whose storages are replaced by a restart: the
+  // restored contexts and the contexts importing fields from them. Their
+  // placeholders are unbound before the storages are replaced
+  struct find_restarted {
+    field_pool &m_pool;
+    unsigned long long m_restored;
+    unsigned long long &m_restarted;
+    find_restarted(field_pool &pool, unsigned long long restored,
+                   unsigned long long &restarted)
+        : m_pool(pool), m_restored(restored), m_restarted(restarted) {}
+    template <typename Index> void operator()(Index const &) {
+      using enum_t = typename type_at<Index::value, context_list_t>::type;
+      if (!m_pool.m_active_context[Index::value])
+        return;
+      bool restarted = m_restored & context_bit(Index::value);
+      for (unsigned int pos = 0; pos < num_contexts; ++pos)
+        if ((m_restored & context_bit(pos)) &&
+            imports_from(typename context_imports<enum_t>::type(), pos))
+          restarted = true;
+      if (!restarted)
+        return;
+      m_restarted |= context_bit(Index::value);
+      m_pool.unbind_context_args<Index::value>();
+    }
+  };
+
+  // imported fields that are views of the fields of their context are set
+  // up again on the restored storages. The transposed ones hold their own
+  // data, that is restored from the checkpoint
+  struct import_restarted {
+    field_pool &m_pool;
+    unsigned long long m_restarted;
+    import_restarted(field_pool &pool, unsigned long long restarted)
+        : m_pool(pool), m_restarted(restarted) {}
+    template <typename Index> void operator()(Index const &) {
+      using enum_t = typename type_at<Index::value, context_list_t>::type;
+      if (m_restarted & context_bit(Index::value))
+        m_pool.transfer_fields(typename context_imports<enum_t>::type(), true,
+                               false);
+    }
+  };
+
+  // restores the repositories of the contexts found in the checkpoint
+  struct restore_checkpoint {
+    tuple_t &m_repos;
+    checkpoint_file const &m_file;
+    restart_mode m_mode;
+    bool m_huge_pages;
+    restore_checkpoint(tuple_t &repos, checkpoint_file const &file,
+                       restart_mode mode, bool huge_pages)
+        : m_repos(repos), m_file(file), m_mode(mode),
+          m_huge_pages(huge_pages) {}
+    template <typename Index> void operator()(Index const &) {
+      std::vector<checkpoint_entry> stored;
+      for (checkpoint_entry const &entry : m_file.entries())
+        if (entry.m_context == Index::value)
+          stored.push_back(entry);
+      if (stored.empty())
+        return;
+
+      auto &repo = std::get<Index::value>(m_repos);
+      if (!repo.is_allocated())
+        throw(std::runtime_error("Can not restart a non active context"));
+      // the region of the repository starts with its first field, the
+      // constant fields being stored after the other ones
+      std::size_t offset = stored.front().m_offset;
+      for (checkpoint_entry const &entry : stored)
+        offset = std::min<std::size_t>(offset, entry.m_offset);
+      // the fields are adopted as they are, therefore the layout of the
+      // repository in the file must be the one of its arena
+      std::vector<checkpoint_entry> expected;
+      repo.checkpoint_entries(Index::value, offset, expected);
+      if (stored != expected)
+        throw(std::runtime_error(
+            "Checkpoint does not match the fields of the context"));
+      repo.restore(
+          m_file.load(offset, repo.footprint(), m_mode, m_huge_pages));
+      repo.restore_constants(m_file, offset + repo.footprint());
+    }
+  };
+
+  // the repositories of the tiles are allocated (and first touched in the
+  // arena modes) by the thread that owns the tile in a static schedule
+  template <unsigned int pos> void allocate_tiles() {
+    const int ntiles = m_tiles.size();
+    bool failed = false;
+#pragma omp parallel for schedule(static) reduction(|| : failed)
+    for (int t = 0; t < ntiles; ++t) {
+      try {
+        std::get<pos>(m_tiles[t]->m_repos).allocate();
+      } catch (...) {
+        failed = true;
+      }
+    }
+    if (failed)
+      throw(std::runtime_error("Can not allocate the tiles of the context"));
+  }
+
+  // shape, element size and memory (of a tile) of a field of a halo
+  // exchange
+  struct halo_field_t {
+    halo_exchange::field_shape m_shape;
+    std::size_t m_element_size;
+    halo_exchange::field_data_t m_data;
+  };
+
+  template <typename EnumT, EnumT param> halo_field_t halo_field() {
+    using storage_t = typename param_storage<EnumT, param>::type;
+    return halo_field_t{
+        halo_shape<typename storage_t::storage_info_t>::value,
+        sizeof(typename storage_t::data_t), [this](unsigned int tile) {
+          return reinterpret_cast<char *>(
+              get_st<EnumT, param>(tile).get_storage_ptr()->get_cpu_ptr());
+        }};
+  }
+
+  // copies a field between the whole domain and the tiles. Each tile is
+  // copied with its halo from the whole domain, and its compute domain back,
+  // with its halo on the boundaries of the domain
+  template <typename EnumT, EnumT param, unsigned int level,
+            typename DataStore>
+  void copy_tiles(DataStore &whole, bool to_tiles) {
+    const int ntiles = m_tiles.size();
+#pragma omp parallel for schedule(static)
+    for (int t = 0; t < ntiles; ++t) {
+      tile_descriptor const &desc = m_tiles[t]->m_descriptor;
+      auto &local = std::get<context_pos<EnumT>::value>(m_tiles[t]->m_repos)
+                        .template get_st<param, level>();
+      const int halo = desc.m_grid.halo();
+      const int ni = desc.m_grid.nx(), nj = desc.m_grid.ny();
+      if (to_tiles) {
+        copy_block(whole, desc.m_i0, desc.m_j0, local, 0, 0, ni + 2 * halo,
+                   nj + 2 * halo);
+        continue;
+      }
+      const int i0 = desc.m_i0 ? halo : 0, j0 = desc.m_j0 ? halo : 0;
+      const int i1 = ni + halo + (desc.m_i0 + ni == m_grid.nx() ? halo : 0);
+      const int j1 = nj + halo + (desc.m_j0 + nj == m_grid.ny() ? halo : 0);
+      copy_block(local, i0, j0, whole, desc.m_i0 + i0, desc.m_j0 + j0,
+                 i1 - i0, j1 - j0);
+    }
+  }
+
+  struct count_fields {
+    std::array<unsigned int, num_contexts> &m_offsets;
+    unsigned int &m_total;
+    count_fields(std::array<unsigned int, num_contexts> &offsets,
+                 unsigned int &total)
+        : m_offsets(offsets), m_total(total) {}
+    template <typename Index> void operator()(Index const &) {
+      m_offsets[Index::value] = m_total;
+      m_total += std::tuple_element<Index::value, tuple_t>::type::num_fields;
+    }
+  };
+
+  // statistics of the fields of each repository
+  struct collect_field_stats {
+    field_pool const &m_pool;
+    pool_stats &m_stats;
+    collect_field_stats(field_pool const &pool, pool_stats &stats)
+        : m_pool(pool), m_stats(stats) {}
+    template <typename Index> void operator()(Index const &) {
+      auto const &repo = std::get<Index::value>(m_pool.m_repos);
+      using enum_t = typename std::decay<decltype(repo)>::type::enum_t;
+      std::vector<checkpoint_entry> entries;
+      repo.checkpoint_entries(Index::value, 0, entries);
+      // the fields of a split domain are held by the tiles, with their halos
+      if (m_pool.split()) {
+        for (checkpoint_entry &entry : entries)
+          entry.m_bytes = 0;
+        for (auto const &tile : m_pool.m_tiles) {
+          std::vector<checkpoint_entry> tile_entries;
+          std::get<Index::value>(tile->m_repos)
+              .checkpoint_entries(Index::value, 0, tile_entries);
+          for (unsigned int i = 0; i < entries.size(); ++i)
+            entries[i].m_bytes += tile_entries[i].m_bytes;
+        }
+      }
+      for (unsigned int i = 0; i < entries.size(); ++i) {
+        field_stats f = field_stats();
+        f.m_context = Index::value;
+        f.m_param = entries[i].m_param;
+        f.m_name = param_name(static_cast<enum_t>(f.m_param));
+        f.m_kind = entries[i].m_kind;
+        std::copy(entries[i].m_shape, entries[i].m_shape + 3, f.m_shape);
+        f.m_element_size = entries[i].m_element_size;
+        f.m_bytes = entries[i].m_bytes;
+        // the fields are held while their context is active
+        f.m_current_bytes =
+            m_pool.m_current_bytes[Index::value] ? f.m_bytes : 0;
+        f.m_peak_bytes = m_pool.m_peak_bytes[Index::value] ? f.m_bytes : 0;
+        f.m_get_st =
+            m_pool.m_get_st_calls[m_pool.m_field_offset[Index::value] + i];
+        f.m_level = entries[i].m_level;
+        const int arg =
+            arg_position(typename args_table_t::fields_list_t(),
+                         static_cast<enum_t>(f.m_param), 0, f.m_level);
+        if (arg >= 0) {
+          f.m_binds = m_pool.m_arg_bindings[arg].m_binds.load();
+          f.m_rebinds = m_pool.m_arg_bindings[arg].m_generation.load();
+        }
+        m_stats.m_fields.push_back(f);
+      }
+    }
+  };
+
+  // footprints of the repositories of the whole domain of each context,
+  // that hold no memory if the domain is split
+  std::array<std::size_t, num_contexts>
+  footprints(bool constant = false) const {
+    std::array<std::size_t, num_contexts> res{};
+    if (!split())
+      for_each_index<num_contexts>(collect_footprints(m_repos, res, constant));
+    return res;
+  }
+
+  // footprints of the repositories of all the tiles of each context
+  std::array<std::size_t, num_contexts>
+  tile_footprints(bool constant = false) const {
+    std::array<std::size_t, num_contexts> res{};
+    for (auto const &tile : m_tiles) {
+      std::array<std::size_t, num_contexts> fp;
+      for_each_index<num_contexts>(
+          collect_footprints(tile->m_repos, fp, constant));
+      for (unsigned int i = 0; i < num_contexts; ++i)
+        res[i] += fp[i];
+    }
+    return res;
+  }
+
+  bool any_context_active() const {
+    return std::any_of(m_active_context.begin(), m_active_context.end(),
+                       [](unsigned int count) { return count != 0; });
+  }
+
+  // size of the arena shared by all the contexts of an alias group
+  std::size_t alias_group_size(int group) const {
+    const std::array<std::size_t, num_contexts> fp = footprints();
+    std::size_t size = 0;
+    for (unsigned int i = 0; i < num_contexts; ++i)
+      if (m_alias_group[i] == group)
+        size = std::max(size, fp[i]);
+    return size;
+  }
 
 public:
+  // creates the field pool for the given grid. It has to be called once
+  // before any call to get_instance()
+  static field_pool &
+  initialize(grid_descriptor const &grid,
+             allocation_mode mode = allocation_mode::per_field,
+             context_mode cmode = context_mode::shared,
+             tiling tiles = tiling());
+  // the instance of the calling thread if it is in an instance_scope,
+  // otherwise the one created by initialize()
   static field_pool &get_instance();
 
-  // for value-initialization of the array
-  field_pool() : m_active_context{} {}
+  class instance_scope;
+
+  // Instances can also be created directly, e.g. one per member of an
+  // ensemble, each with its own fields and contexts.
+  field_pool(grid_descriptor const &grid,
+             allocation_mode mode = allocation_mode::per_field,
+             context_mode cmode = context_mode::shared,
+             tiling tiles = tiling())
+      : m_instance_id(m_num_instances.fetch_add(1)), m_grid(grid),
+        m_sinfos(make_storage_infos(grid)),
+        m_repos(make_repos<tuple_t>::apply(m_sinfos, mode)),
+        m_runtime_repo(storage_info_3d(), storage_info_2d()),
+        m_tiling(tiles), m_tile_descriptors(decompose(grid, tiles)),
+        m_active_context{},
+        m_active_mask(0), m_context_mode(cmode), m_mode(mode),
+        m_activations{}, m_current_bytes{}, m_peak_bytes{}, m_total_bytes(0),
+        m_total_peak_bytes(0) {
+    GRIDTOOLS_STATIC_ASSERT((num_contexts <= 64),
+                            "the active context mask holds up to 64 contexts");
+    m_alias_group.fill(-1);
+    m_tracers.reserve(num_contexts);
+    for (unsigned int i = 0; i < num_contexts; ++i)
+      m_tracers.push_back(tracer_bundle(m_grid, storage_info_3d(), mode));
+    unsigned int num_fields = 0;
+    for_each_index<num_contexts>(count_fields(m_field_offset, num_fields));
+    m_get_st_calls = std::vector<std::atomic<unsigned long>>(num_fields);
+    // with a single tile, the tile is the whole domain
+    if (m_tile_descriptors.size() > 1)
+      for (tile_descriptor const &desc : m_tile_descriptors)
+        m_tiles.push_back(
+            std::unique_ptr<tile_storage>(new tile_storage(desc, mode)));
+  }
+
+  field_pool(field_pool const &) = delete;
+  field_pool &operator=(field_pool const &) = delete;
+
+  grid_descriptor const &grid() const { return m_grid; }
+  storage_info_3d_t const &storage_info_3d() const {
+    return m_sinfos.get<storage_info_3d_t>();
+  }
+  storage_info_2d_t const &storage_info_2d() const {
+    return m_sinfos.get<storage_info_2d_t>();
+  }
+
+  // Makes the instance use the constant fields (see constant_fields) of
+  // source, i.e. another member of an ensemble, instead of its own, so that
+  // they are stored once for all the members. The instances must have the
+  // same grid and tiles, and this instance can not have any active context.
+  // The constant fields are allocated (in the arena of source) if needed
+  void share_constants(field_pool &source) {
+    if (&source == this)
+      return;
+    std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+    std::unique_lock<std::mutex> source_lock(source.m_mutex, std::defer_lock);
+    std::lock(lock, source_lock);
+    if (any_context_active())
+      throw(std::runtime_error(
+          "Can not share the constant fields of an active context"));
+    if (m_grid != source.m_grid ||
+        m_tile_descriptors.size() != source.m_tile_descriptors.size())
+      throw(std::runtime_error(
+          "Can not share constant fields between different grids"));
+    for (unsigned int t = 0; t < m_tiles.size(); ++t)
+      if (m_tiles[t]->m_descriptor.m_grid !=
+          source.m_tiles[t]->m_descriptor.m_grid)
+        throw(std::runtime_error(
+            "Can not share constant fields between different tiles"));
+    if (!split())
+      for_each_index<num_contexts>(
+          share_repos_constants(m_repos, source.m_repos));
+    for (unsigned int t = 0; t < m_tiles.size(); ++t)
+      for_each_index<num_contexts>(share_repos_constants(
+          m_tiles[t]->m_repos, source.m_tiles[t]->m_repos));
+  }
+
+  // Makes the constant fields read only once they are initialized, writes to
+  // them fault, for all the instances that share them. They are not read
+  // from checkpoints while they are read only
+  void protect_constants(bool read_only = true) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!split())
+      for_each_index<num_contexts>(
+          protect_repos_constants(m_repos, read_only));
+    for (auto &tile : m_tiles)
+      for_each_index<num_contexts>(
+          protect_repos_constants(tile->m_repos, read_only));
+  }
+
+  // whether the constant fields of the context are shared with the instance
+  template <typename EnumT>
+  bool shares_constants_with(field_pool const &other) const {
+    constexpr unsigned int pos = context_pos<EnumT>::value;
+    if (split())
+      return other.split() && std::get<pos>(m_tiles[0]->m_repos)
+                                  .shares_constants_with(std::get<pos>(
+                                      other.m_tiles[0]->m_repos));
+    return std::get<pos>(m_repos).shares_constants_with(
+        std::get<pos>(other.m_repos));
+  }
 
   template <typename EnumT, EnumT param> struct param_storage {
     using type = typename std::tuple_element<
-        boost::mpl::find<context_list_t, EnumT>::type::pos::value,
+        context_pos<EnumT>::value,
         tuple_t>::type::template param_storage<param>::type;
   };
 
-  template <typename EnumT, EnumT param>
-  typename param_storage<EnumT, param>::type get_st() {
-    if (!m_active_context[boost::mpl::find<context_list_t,
-                                           EnumT>::type::pos::value])
+  // tiles of the domain, a single tile covering the whole domain if the
+  // domain is not split
+  unsigned int num_tiles() const { return m_tile_descriptors.size(); }
+  tile_descriptor const &get_tile(unsigned int tile) const {
+    return m_tile_descriptors.at(tile);
+  }
+
+  // Access to the storage of a tile of an active context, sized for the grid
+  // of the tile (with its own halo). If the domain is not split, it is the
+  // storage of the whole domain
+  template <typename EnumT, EnumT param, unsigned int level = 0>
+  typename param_storage<EnumT, param>::type &get_st(unsigned int tile) {
+    if (m_tiles.empty())
+      return get_st<EnumT, param, level>();
+#if FIELD_POOL_CHECK_CONTEXT
+    if (!context_active(context_pos<EnumT>::value))
+      throw(std::runtime_error("Can not access storage out of context"));
+    if (tile >= m_tiles.size())
+      throw(std::runtime_error("Invalid tile"));
+#endif
+    return std::get<context_pos<EnumT>::value>(m_tiles[tile]->m_repos)
+        .template get_st<param, level>();
+  }
+
+  // creates an exchange of the halos of the fields between the tiles, e.g.
+  // make_halo_exchange<dycore_param, dycore_param::u, dycore_param::v>().
+  // The context must be active whenever the halos are exchanged, and the
+  // time level 0 of the fields is exchanged
+  template <typename EnumT, EnumT... params>
+  std::unique_ptr<halo_exchange> make_halo_exchange() {
+    std::unique_ptr<halo_exchange> res(
+        new halo_exchange(m_tiling, m_tile_descriptors));
+    for (auto const &field : {halo_field<EnumT, params>()...})
+      res->add_field(field.m_shape, field.m_element_size, field.m_data);
+    return res;
+  }
+
+  // copies a field of the whole domain (e.g. read from the input) to (a
+  // time level of) the field of the tiles, compute domain and halo of each
+  // tile. If the domain is not split, it is copied to the field itself
+  template <typename EnumT, EnumT param, unsigned int level = 0>
+  void scatter_to_tiles(typename param_storage<EnumT, param>::type &whole) {
+    if (split()) {
+      copy_tiles<EnumT, param, level>(whole, true);
+      return;
+    }
+    auto &field = get_st<EnumT, param, level>();
+    if (&field != &whole)
+      copy_block(whole, 0, 0, field, 0, 0, m_grid.isize(), m_grid.jsize());
+  }
+
+  // gathers (a time level of) the field of the tiles into a temporary field
+  // of the whole domain, e.g. for the output, that is valid until the
+  // returned scratch field goes out of scope
+  template <typename EnumT, EnumT param, unsigned int level = 0>
+  scratch_field<typename param_storage<EnumT, param>::type>
+  gather_from_tiles() {
+    using storage_t = typename param_storage<EnumT, param>::type;
+    scratch_field<storage_t> whole = get_scratch<storage_t>();
+    if (split())
+      copy_tiles<EnumT, param, level>(whole.get(), false);
+    else
+      copy_block(get_st<EnumT, param, level>(), 0, 0, whole.get(), 0, 0,
+                 m_grid.isize(), m_grid.jsize());
+    return whole;
+  }
+
+  // Access to a storage of an active context. The context is checked at
+  // runtime only if FIELD_POOL_CHECK_CONTEXT is set. The level selects the
+  // time level of the fields declared with time_levels<>. The fields of a
+  // split domain are only held by the tiles, see get_st(tile) and
+  // gather_from_tiles
+  template <typename EnumT, EnumT param, unsigned int level = 0>
+  typename param_storage<EnumT, param>::type &get_st() {
+#if FIELD_POOL_CHECK_CONTEXT
+    if (!context_active(context_pos<EnumT>::value))
       throw(std::runtime_error("Can not access storage out of context"));
+    if (split())
+      throw(std::runtime_error("A split domain is only held by its tiles"));
+#endif
+#if FIELD_POOL_STATS
+    count_get_st<EnumT, param, level>();
+#endif
+    return std::get<context_pos<EnumT>::value>(m_repos)
+        .template get_st<param, level>();
+  }
+
+  // Access to a storage of a context proven to be active by a scoped
+  // context_guard of this pool. The pool of the guard is checked at runtime
+  // only if FIELD_POOL_CHECK_CONTEXT is set.
+  template <typename EnumT, EnumT param, unsigned int level = 0,
+            typename... Active>
+  typename param_storage<EnumT, param>::type &
+  get_st(context_guard<Active...> const &guard) {
+    GRIDTOOLS_STATIC_ASSERT((is_one_of<EnumT, Active...>::value),
+                            "Can not access storage out of context");
+#if FIELD_POOL_CHECK_CONTEXT
+    if (guard.pool() != this)
+      throw(std::runtime_error("The context guard is not active in this pool"));
+#endif
+#if FIELD_POOL_STATS
+    count_get_st<EnumT, param, level>();
+#endif
+    return std::get<context_pos<EnumT>::value>(m_repos)
+        .template get_st<param, level>();
+  }
+
+  // Temporary field of an operator, e.g.
+  //   auto tmp = fpool.get_scratch<data_store_3d_t>();
+  // with the shape of its storage info on the grid (or on the grid of a
+  // tile, or any storage info). The field is not initialized, and its
+  // memory is reused by the next temporaries once tmp goes out of scope
+  template <typename DataStore> scratch_field<DataStore> get_scratch() {
+    return scratch_field<DataStore>(
+        m_scratch, m_sinfos.get<typename DataStore::storage_info_t>());
+  }
+
+  template <typename DataStore>
+  scratch_field<DataStore> get_scratch(unsigned int tile) {
+    if (m_tiles.empty())
+      return get_scratch<DataStore>();
+    if (tile >= m_tiles.size())
+      throw(std::runtime_error("Invalid tile"));
+    return scratch_field<DataStore>(
+        m_scratch,
+        m_tiles[tile]->m_sinfos.get<typename DataStore::storage_info_t>());
+  }
+
+  template <typename DataStore>
+  scratch_field<DataStore>
+  get_scratch(typename DataStore::storage_info_t const &sinfo) {
+    return scratch_field<DataStore>(m_scratch, sinfo);
+  }
 
-    return std::get<boost::mpl::find<context_list_t, EnumT>::type::pos::value>(
-               m_repos)
-        .get_st<param>();
+  // Rotates the time levels of the fields of an active context at the end
+  // of a time step (new becomes now), in the whole domain or in the tiles.
+  // Only the storages are swapped, and the placeholders already bound to the
+  // time levels of the whole domain are rebound, so that the cost does not
+  // depend on the grid. The fields imported by an active context would keep
+  // the previous time level, therefore the rotation throws while a context
+  // imports fields from this one
+  template <typename EnumT> void rotate_time_levels() {
+    constexpr unsigned int pos = context_pos<EnumT>::value;
+#if FIELD_POOL_CHECK_CONTEXT
+    if (!context_active(pos))
+      throw(std::runtime_error("Can not rotate time levels out of context"));
+#endif
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      bool imported = false;
+      for_each_index<num_contexts>(find_importers(*this, pos, imported));
+      if (imported)
+        throw(std::runtime_error("Can not rotate the time levels of a "
+                                 "context imported by an active context"));
+    }
+    for (auto &tile : m_tiles)
+      std::get<pos>(tile->m_repos).rotate_time_levels();
+    if (split())
+      return;
+    std::get<pos>(m_repos).rotate_time_levels();
+    rebind_levels_list(
+        typename std::tuple_element<pos, tuple_t>::type::fields_list_t());
   }
+
+  // Activates a context for the current scope. The returned guard proves at
+  // compile time that the context is active, and deactivates it when it goes
+  // out of scope
+  template <typename EnumT> context_guard<EnumT> enter_context() {
+    activate_context<EnumT>();
+    return context_guard<EnumT>(*this);
+  }
+
+  // Activates a context nested in the contexts of the parent guard, the
+  // returned guard proves all of them to be active
+  template <typename EnumT, typename... Parents>
+  context_guard<EnumT, Parents...>
+  enter_context(context_guard<Parents...> const &) {
+    activate_context<EnumT>();
+    return context_guard<EnumT, Parents...>(*this);
+  }
+
+  // Contexts can be activated in a nested way, m_active_context counts the
+  // number of activations of each context. The storages of a context are
+  // allocated when it is first activated and released when the last
+  // activation is deactivated, so that only active contexts hold memory.
+  // In context_mode::per_thread, each thread has its own nesting of
+  // contexts, and a context holds memory while any thread has it active.
+  // each activation is traced as a span named after the context, that ends
+  // with the matching deactivation
   template <typename EnumT> void activate_context() {
-    m_active_context[boost::mpl::find<context_list_t,
-                                      EnumT>::type::pos::value] = true;
+    constexpr unsigned int pos = context_pos<EnumT>::value;
+    if (m_context_mode == context_mode::per_thread) {
+      thread_context_state &state = this_thread_state();
+      if (!state.m_count[pos]) {
+        acquire_context<EnumT>();
+        state.m_mask |= context_bit(pos);
+      }
+      ++state.m_count[pos];
+    } else {
+      acquire_context<EnumT>();
+    }
+    FIELD_POOL_TRACE_BEGIN("context", context_name(pos));
   }
 
   template <typename EnumT> void deactivate_context() {
-    m_active_context[boost::mpl::find<context_list_t,
-                                      EnumT>::type::pos::value] = false;
+    constexpr unsigned int pos = context_pos<EnumT>::value;
+    if (m_context_mode == context_mode::per_thread) {
+      thread_context_state &state = this_thread_state();
+      if (!state.m_count[pos])
+        throw(std::runtime_error("Can not deactivate a non active context"));
+      // the state of the thread is only changed once the context is
+      // released, so that the deactivation can be retried if it throws
+      if (state.m_count[pos] == 1) {
+        release_context<EnumT>();
+        state.m_mask &= ~context_bit(pos);
+      }
+      --state.m_count[pos];
+    } else {
+      release_context<EnumT>();
+    }
+    FIELD_POOL_TRACE_END("context", context_name(pos));
   }
 
-  template <typename... Params> void bind_all_args() {
-    // here we should bind all the prognostic and constant fields placeholders
+  // whether the context is active (for the calling thread in
+  // context_mode::per_thread). It does not take any lock
+  template <typename EnumT> bool is_active() const {
+    return context_active(context_pos<EnumT>::value);
   }
 
-  template <typename EnumT, EnumT param, typename Storage>
-  void bind_arg(Storage st) {
-    get_arg<EnumT, param>() = st;
+  // Adds a tracer to the bundle of tracers of the context EnumT. Tracers can
+  // only be added while the context is not active (i.e. at model setup), an
+  // active context with an empty bundle holds no tracer storage either
+  template <typename EnumT> unsigned int add_tracer(std::string const &name) {
+    constexpr unsigned int pos = context_pos<EnumT>::value;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_active_context[pos])
+      throw(std::runtime_error("Can not add a tracer to an active context"));
+    return m_tracers[pos].add_tracer(name);
   }
 
-  template <typename EnumT, EnumT param>
-  typename boost::mpl::at<args_t, boost::mpl::integral_c<EnumT, param>>::type
-  get_arg() {
+  template <typename EnumT> tracer_bundle &get_tracers() {
+#if FIELD_POOL_CHECK_CONTEXT
+    if (!context_active(context_pos<EnumT>::value))
+      throw(std::runtime_error("Can not access tracers out of context"));
+#endif
+    return m_tracers[context_pos<EnumT>::value];
+  }
+
+  // Registers a field accessed by name, that belongs to the context EnumT.
+  // Registration happens at model setup, the returned field_id should be
+  // kept to access the storage in the hot path.
+  template <typename EnumT, typename DataStore>
+  field_id register_field(std::string const &name) {
+    constexpr unsigned int pos = context_pos<EnumT>::value;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const field_id id = m_runtime_repo.register_field<DataStore>(
+        name, pos, m_active_context[pos] > 0);
+    if (m_active_context[pos])
+      account_context_bytes<pos>(true);
+    return id;
+  }
+
+  field_id const &get_field_id(std::string const &name) const {
+    return m_runtime_repo.find(name);
+  }
+
+  // the reference is valid until another field is registered
+  template <typename DataStore> DataStore &get_st(field_id const &id) {
+#if FIELD_POOL_CHECK_CONTEXT
+    if (id.m_kind != runtime_storage_kind<DataStore>::value)
+      throw(std::runtime_error("Wrong storage type for field"));
+    if (!context_active(id.m_context))
+      throw(std::runtime_error("Can not access storage out of context"));
+#endif
+    return m_runtime_repo.get<DataStore>(id);
+  }
+
+  template <typename DataStore> DataStore &get_st(std::string const &name) {
+    return get_st<DataStore>(m_runtime_repo.find(name));
+  }
+
+  // Declares that the lifetimes of the given contexts never overlap, so that
+  // their fields can be placed in the same physical buffer. The buffer is
+  // allocated at the activation of any of the contexts, and released when
+  // none of them is active. Activating a context while another context of the
+  // group is active throws. Contexts nested in each other (through their
+  // imported fields) are always active together, and can not be aliased.
+  template <typename... Contexts> void alias_contexts() {
     GRIDTOOLS_STATIC_ASSERT(
-        (boost::mpl::has_key<args_t,
-                             boost::mpl::integral_c<EnumT, param>>::value),
-        "Error");
+        (first_true(0, nested_in_any<Contexts, Contexts...>::value...) < 0),
+        "Can not alias contexts that are nested in each other");
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const unsigned int positions[] = {context_pos<Contexts>::value...};
+    const int group = m_alias_arenas.size();
+    for (unsigned int pos : positions) {
+      if (m_active_context[pos])
+        throw(std::runtime_error("Can not alias an active context"));
+      if (m_alias_group[pos] >= 0)
+        throw(std::runtime_error(
+            "A context can only belong to one alias group"));
+    }
+    for (unsigned int pos : positions)
+      m_alias_group[pos] = group;
+    m_alias_arenas.push_back(std::shared_ptr<arena>());
+  }
+
+  // peak footprint of all the repositories, before and after aliasing the
+  // declared alias groups. The repositories of the tiles are never aliased,
+  // i.e. the groups have no effect on a split domain
+  memory_plan plan_memory() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::array<std::size_t, num_contexts> fp = footprints();
+    const std::array<std::size_t, num_contexts> constant = footprints(true);
+    const std::array<std::size_t, num_contexts> tiles = tile_footprints();
+    const std::array<std::size_t, num_contexts> tile_constant =
+        tile_footprints(true);
+    memory_plan plan{0, 0, 0};
+    for (unsigned int i = 0; i < num_contexts; ++i) {
+      plan.m_unaliased_peak += fp[i] + tiles[i];
+      plan.m_aliased_peak += tiles[i];
+      if (m_alias_group[i] < 0)
+        plan.m_aliased_peak += fp[i];
+      plan.m_constant_bytes += constant[i] + tile_constant[i];
+    }
+    for (unsigned int group = 0; group < m_alias_arenas.size(); ++group)
+      plan.m_aliased_peak += alias_group_size(group);
+    return plan;
+  }
+
+  // memory held by each context (now and at the peak), activations and
+  // active time of each context, and usage of each field and placeholder
+  pool_stats stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> bind_lock(m_bind_mutex);
+    pool_stats res;
+    res.m_current_bytes = m_total_bytes;
+    res.m_peak_bytes = m_total_peak_bytes;
+    res.m_counts_get_st = FIELD_POOL_STATS;
+    const std::array<std::size_t, num_contexts> fp = footprints();
+    const std::array<std::size_t, num_contexts> constant = footprints(true);
+    const std::array<std::size_t, num_contexts> tiles = tile_footprints();
+    for (unsigned int i = 0; i < num_contexts; ++i)
+      res.m_contexts.push_back(context_stats{
+          context_name(i), fp[i], constant[i], tiles[i], m_current_bytes[i],
+          m_peak_bytes[i], m_activations[i], m_active_time[i].seconds()});
+    for_each_index<num_contexts>(collect_field_stats(*this, res));
+    for (unsigned int i = 0; i < m_arg_bindings.size(); ++i)
+      res.m_placeholders.push_back(placeholder_stats{
+          i, m_arg_bindings[i].m_binds.load(),
+          m_arg_bindings[i].m_generation.load()});
+    res.m_scratch = m_scratch.stats();
+    return res;
+  }
+
+  // writes stats() as JSON to the file path
+  void write_stats(std::string const &path) const;
+
+  // writes the stats of the field pool instance to path at the exit of the
+  // program
+  static void write_stats_at_exit(std::string const &path);
+
+  // writes the repositories of all the active contexts to a single file: a
+  // header with one entry (context, param, shape and offset) per field,
+  // followed by the fields of each repository with the layout of its arena.
+  // The repositories of the tiles are not written, a pool split in tiles can
+  // not be checkpointed
+  void write_checkpoint(std::string const &path) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_tiles.empty())
+      throw(std::runtime_error("Can not checkpoint a pool split in tiles"));
+    std::vector<checkpoint_entry> entries;
+    for_each_index<num_contexts>(
+        collect_checkpoint(m_repos, 0, entries, NULL));
+    const std::size_t data_offset = arena::align_up(
+        sizeof(checkpoint_header) + entries.size() * sizeof(checkpoint_entry),
+        arena::field_alignment);
+
+    entries.clear();
+    std::vector<char const *> data;
+    for_each_index<num_contexts>(
+        collect_checkpoint(m_repos, data_offset, entries, &data));
+    ::write_checkpoint(path, entries, data);
+  }
+
+  // restores the repositories stored in a checkpoint, whose contexts must be
+  // active. The fields are placed on top of a (copy on write) mapping of the
+  // file, or read into new arenas. Handles to the previous storages are not
+  // updated. The placeholders bound to the restored contexts, and to the
+  // active contexts importing from them, are unbound (and rebound by the
+  // next bind_arg), and the imported views are set up on the restored
+  // fields. A pool split in tiles can not be restarted
+  void restart(std::string const &path,
+               restart_mode mode = restart_mode::map) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_tiles.empty())
+      throw(std::runtime_error("Can not restart a pool split in tiles"));
+    checkpoint_file file(path);
+    unsigned long long restored = 0;
+    for (checkpoint_entry const &entry : file.entries()) {
+      if (entry.m_context >= num_contexts)
+        throw(std::runtime_error("Unknown context in checkpoint " + path));
+      restored |= context_bit(entry.m_context);
+    }
+    unsigned long long restarted = 0;
+    for_each_index<num_contexts>(find_restarted(*this, restored, restarted));
+    for_each_index<num_contexts>(restore_checkpoint(
+        m_repos, file, mode, m_mode == allocation_mode::arena_huge_pages));
+    for_each_index<num_contexts>(import_restarted(*this, restarted));
+  }
+
+  // creates the output stage, snapshots are written in the background to
+  // <prefix>_<step>.out, with nbuffers staging buffers
+  void set_output(std::string const &prefix, unsigned int nbuffers = 2) {
+    m_output.reset(new output_stage(prefix, nbuffers));
+  }
+
+  // adds a field of the context EnumT to the output. The context must be
+  // active whenever a snapshot is taken, and the domain can not be split
+  template <typename EnumT, EnumT param>
+  void add_output(std::string const &name) {
+    if (!m_output)
+      throw(std::runtime_error("The output stage is not set"));
+    if (split())
+      throw(std::runtime_error("Can not output the fields of a split domain"));
+    const std::size_t bytes = std::get<context_pos<EnumT>::value>(m_repos)
+                                  .template field_bytes<param>();
+    m_output->add_field(name, bytes, [this]() {
+      return reinterpret_cast<char const *>(
+          get_st<EnumT, param>().get_storage_ptr()->get_cpu_ptr());
+    });
+  }
+
+  // copies the output fields to a staging buffer, they are written while
+  // the model goes on. It waits if the writer is behind by all the buffers
+  void write_output(unsigned long step) {
+    if (!m_output)
+      throw(std::runtime_error("The output stage is not set"));
+    m_output->snapshot(step);
+  }
+
+  output_stage &get_output() {
+    if (!m_output)
+      throw(std::runtime_error("The output stage is not set"));
+    return *m_output;
+  }
+
+  // binds the placeholders of all the fields of the repo info of a context
+  // to the storages of its repository. Bindings that did not change are
+  // skipped, so that constant fields are only bound once per activation
+  template <typename RepoInfo> void bind_all_args() {
+    bind_fields_list(typename RepoInfo::fields_list_t());
+  }
+
+  // binds the placeholder to the storage, and returns the generation of the
+  // binding. The generation only changes when the placeholder is bound to a
+  // different storage, so that computations can skip the setup of their
+  // domain when the generations of their placeholders did not change.
+  // A binding to the storage the placeholder is already bound to does not
+  // take any lock, rebindings from several threads are serialized. A
+  // placeholder is shared by all the threads: the computations that bind
+  // the same placeholders must not run concurrently (e.g. the task graph
+  // orders the calls of an operator that is also passed as one of its
+  // outputs)
+  template <typename EnumT, EnumT param, unsigned int level = 0,
+            typename Storage>
+  unsigned long bind_arg(Storage const &st) {
+    arg_binding &binding = m_arg_bindings
+        [args_table_t::template index<EnumT, param, level>::value];
+    binding.m_binds.fetch_add(1, std::memory_order_relaxed);
+    void const *storage = st.get_storage_ptr().get();
+    // the generation is published after the storage and the placeholder
+    const unsigned long generation =
+        binding.m_generation.load(std::memory_order_acquire);
+    if (generation &&
+        binding.m_storage.load(std::memory_order_relaxed) == storage)
+      return generation;
+
+    std::lock_guard<std::mutex> lock(m_bind_mutex);
+    if (binding.m_generation.load(std::memory_order_relaxed) == 0 ||
+        binding.m_storage.load(std::memory_order_relaxed) != storage) {
+      get_arg<EnumT, param, level>() = st;
+      binding.m_storage.store(storage, std::memory_order_relaxed);
+      binding.m_generation.fetch_add(1, std::memory_order_release);
+    }
+    return binding.m_generation.load(std::memory_order_relaxed);
+  }
+
+  template <typename EnumT, EnumT param, unsigned int level = 0>
+  unsigned long arg_generation() const {
+    return m_arg_bindings
+        [args_table_t::template index<EnumT, param, level>::value]
+            .m_generation.load(std::memory_order_acquire);
+  }
+
+  template <typename EnumT, EnumT param, unsigned int level = 0>
+  auto get_arg() -> decltype(args_table_t::template get<EnumT, param, level>(
+      std::declval<args_tuple_t &>())) {
+    return args_table_t::template get<EnumT, param, level>(m_args_tuple);
+  }
+};
+
+/**
+ * Makes fpool the instance returned by field_pool::get_instance() in the
+ * calling thread for the lifetime of the scope, so that the operators of a
+ * member of an ensemble run on the instance of the member, e.g. one thread
+ * (or task) per member. Scopes can be nested, and do not apply to the
+ * threads started in the scope
+ */
+class field_pool::instance_scope {
+public:
+  explicit instance_scope(field_pool &fpool) : m_previous(m_thread_instance) {
+    m_thread_instance = &fpool;
+  }
+  ~instance_scope() { m_thread_instance = m_previous; }
+
+  instance_scope(instance_scope const &) = delete;
+  instance_scope &operator=(instance_scope const &) = delete;
 
-    using idx =
-        typename boost::mpl::at<args_to_index_t,
-                                boost::mpl::integral_c<EnumT, param>>::type;
-    return std::get<idx::value>(m_args_tuple);
+private:
+  field_pool *m_previous;
+};
+
+/**
+ * Scoped activation of the context EnumT, created by
+ * field_pool::enter_context. The type of the guard lists the contexts that
+ * are known to be active in its scope (EnumT and the contexts of the parent
+ * guard), so that field_pool::get_st(guard) can check them at compile time.
+ * The proof only holds in the thread that created the guard.
+ *
+ * Guards must be left in the reverse order of their creation: a context
+ * whose fields are imported by an active context can not be deactivated.
+ * leave() deactivates the context and throws on such errors, while the
+ * destructor can not throw, and only reports them on std::cerr (the context
+ * then stays active).
+ */
+template <typename EnumT, typename... Parents>
+class context_guard<EnumT, Parents...> {
+public:
+  explicit context_guard(field_pool &fpool) : m_fpool(&fpool) {}
+
+  context_guard(context_guard &&other) : m_fpool(other.m_fpool) {
+    other.m_fpool = NULL;
   }
+
+  context_guard(context_guard const &) = delete;
+  context_guard &operator=(context_guard const &) = delete;
+
+  ~context_guard() {
+    // exceptions can not leave a destructor
+    try {
+      leave();
+    } catch (std::exception const &e) {
+      std::cerr << e.what() << std::endl;
+    }
+  }
+
+  // deactivates the context before the end of the scope of the guard, that
+  // must not be used to access fields afterwards
+  void leave() {
+    if (!m_fpool)
+      return;
+    m_fpool->deactivate_context<EnumT>();
+    m_fpool = NULL;
+  }
+
+  // pool of the active context, null once the guard is left
+  field_pool const *pool() const { return m_fpool; }
+
+private:
+  field_pool *m_fpool;
 };
@@ -0,0 +1,99 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+#pragma once
+#include <stdexcept>
+
+/**
+ * Description of the computational domain used to size all the storages of
+ * the repositories. The halo and the padding are folded into the extents of
+ * the storage infos, since the halo and alignment of the GridTools storage
+ * infos are compile time parameters.
+ */
+struct grid_descriptor {
+
+  /**
+   * @param nx, ny, nz size of the compute domain
+   * @param halo width of the halo in the i and j dimensions
+   * @param alignment the (haloed) i extent is rounded up to a multiple of
+   * alignment elements
+   * @param padding number of elements added to the aligned i extent. It can be
+   * used to avoid power of two strides, that produce cache set conflicts among
+   * the many fields of the same shape.
+   */
+  grid_descriptor(unsigned int nx, unsigned int ny, unsigned int nz,
+                  unsigned int halo = 0, unsigned int alignment = 1,
+                  unsigned int padding = 0)
+      : m_nx(nx), m_ny(ny), m_nz(nz), m_halo(halo), m_alignment(alignment),
+        m_padding(padding) {
+    if (!nx || !ny || !nz)
+      throw(std::runtime_error("Grid dimensions must be non zero"));
+    if (!alignment)
+      throw(std::runtime_error("Alignment must be non zero"));
+  }
+
+  unsigned int nx() const { return m_nx; }
+  unsigned int ny() const { return m_ny; }
+  unsigned int nz() const { return m_nz; }
+  unsigned int halo() const { return m_halo; }
+  unsigned int alignment() const { return m_alignment; }
+  unsigned int padding() const { return m_padding; }
+
+  // extents of the allocated storages, including halos and padding
+  unsigned int isize() const {
+    const unsigned int ni = m_nx + 2 * m_halo;
+    return ((ni + m_alignment - 1) / m_alignment) * m_alignment + m_padding;
+  }
+  unsigned int jsize() const { return m_ny + 2 * m_halo; }
+  unsigned int ksize() const { return m_nz; }
+  // levels of the staggered fields, defined on the interfaces of the levels
+  unsigned int ksize_staggered() const { return m_nz + 1; }
+
+  bool operator==(grid_descriptor const &other) const {
+    return m_nx == other.m_nx && m_ny == other.m_ny && m_nz == other.m_nz &&
+           m_halo == other.m_halo && m_alignment == other.m_alignment &&
+           m_padding == other.m_padding;
+  }
+  bool operator!=(grid_descriptor const &other) const {
+    return !(*this == other);
+  }
+
+private:
+  unsigned int m_nx, m_ny, m_nz;
+  unsigned int m_halo;
+  unsigned int m_alignment;
+  unsigned int m_padding;
+};
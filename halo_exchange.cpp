@@ -0,0 +1,232 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#include <cstring>
+#include <thread>
+#include "halo_exchange.hpp"
+
+namespace {
+// first point of the region sent to (or received from) the neighbor at
+// offset d (-1, 0 or 1) along a dimension of n points, in storage
+// coordinates, and the size of the region
+int send_first(int d, int n, int halo) { return d > 0 ? n : halo; }
+
+int receive_first(int d, int n, int halo) {
+  return d < 0 ? 0 : (d > 0 ? halo + n : halo);
+}
+
+int region_size(int d, int n, int halo) { return d == 0 ? n : halo; }
+
+// offsets of the elements of the region, enumerated with k varying
+// fastest, then j and i, the same order on both sides of a message
+template <typename StorageInfo>
+std::vector<int> make_offsets(StorageInfo const &sinfo, int i0, int ni,
+                              int j0, int nj) {
+  std::vector<int> res;
+  const int nk = levels(sinfo);
+  for (int i = i0; i < i0 + ni; ++i)
+    for (int j = j0; j < j0 + nj; ++j)
+      for (int k = 0; k < nk; ++k)
+        res.push_back(element_index(sinfo, i, j, k));
+  return res;
+}
+
+// offsets of the elements of the region in the storages of a shape
+std::vector<int> make_offsets(storage_infos_t const &sinfos,
+                              halo_exchange::field_shape shape, int i0, int ni,
+                              int j0, int nj) {
+  switch (shape) {
+  case halo_exchange::shape_3d:
+    return make_offsets(sinfos.get<storage_info_3d_t>(), i0, ni, j0, nj);
+  case halo_exchange::shape_3d_stag:
+    return make_offsets(sinfos.get<storage_info_3d_stag_t>(), i0, ni, j0, nj);
+  case halo_exchange::shape_3d_column:
+    return make_offsets(sinfos.get<storage_info_3d_column_t>(), i0, ni, j0,
+                        nj);
+  default:
+    return make_offsets(sinfos.get<storage_info_2d_t>(), i0, ni, j0, nj);
+  }
+}
+
+// merges the offsets in runs of contiguous elements
+template <typename Plan>
+std::size_t make_plan(Plan &plan, std::vector<int> const &offs) {
+  for (int off : offs) {
+    if (!plan.empty() && plan.back().m_offset + plan.back().m_count == off)
+      ++plan.back().m_count;
+    else
+      plan.push_back({off, 1});
+  }
+  return offs.size();
+}
+
+template <typename Plan>
+char *pack(Plan const &plan, std::size_t element_size, char const *field,
+           char *buf) {
+  for (auto const &r : plan) {
+    std::memcpy(buf, field + r.m_offset * element_size,
+                r.m_count * element_size);
+    buf += r.m_count * element_size;
+  }
+  return buf;
+}
+
+template <typename Plan>
+char const *unpack(Plan const &plan, std::size_t element_size,
+                   char const *buf, char *field) {
+  for (auto const &r : plan) {
+    std::memcpy(field + r.m_offset * element_size, buf,
+                r.m_count * element_size);
+    buf += r.m_count * element_size;
+  }
+  return buf;
+}
+} // namespace
+
+halo_exchange::halo_exchange(tiling const &tiles,
+                             std::vector<tile_descriptor> const &descriptors)
+    : m_sends(descriptors.size()), m_receives(descriptors.size()),
+      m_started(false) {
+  if (descriptors.size() != tiles.size())
+    throw(std::runtime_error("The tiles do not match the tiling"));
+  const int nti = tiles.ntiles_i(), ntj = tiles.ntiles_j();
+
+  for (tile_descriptor const &src : descriptors) {
+    const int ti = src.m_index % nti, tj = src.m_index / nti;
+    const int halo = src.m_grid.halo();
+    if (descriptors.size() > 1 &&
+        (src.m_grid.nx() < (unsigned int)halo ||
+         src.m_grid.ny() < (unsigned int)halo))
+      throw(std::runtime_error("The tiles are smaller than the halo"));
+
+    for (int dj = -1; dj <= 1; ++dj)
+      for (int di = -1; di <= 1; ++di) {
+        if ((!di && !dj) || ti + di < 0 || ti + di >= nti || tj + dj < 0 ||
+            tj + dj >= ntj)
+          continue;
+        tile_descriptor const &dst =
+            descriptors[(tj + dj) * nti + (ti + di)];
+        std::unique_ptr<channel> ch(new channel());
+        ch->m_source = src.m_index;
+        ch->m_dest = dst.m_index;
+
+        // the destination receives from the opposite direction, the
+        // regions have the same size since neighbors along a dimension have
+        // the same number of points along the other one
+        const int si = send_first(di, src.m_grid.nx(), halo);
+        const int sj = send_first(dj, src.m_grid.ny(), halo);
+        const int ri = receive_first(-di, dst.m_grid.nx(), halo);
+        const int rj = receive_first(-dj, dst.m_grid.ny(), halo);
+        const int ni = region_size(di, src.m_grid.nx(), halo);
+        const int nj = region_size(dj, src.m_grid.ny(), halo);
+
+        const storage_infos_t src_sinfos = make_storage_infos(src.m_grid);
+        const storage_infos_t dst_sinfos = make_storage_infos(dst.m_grid);
+        for (unsigned int s = 0; s < num_shapes; ++s) {
+          const field_shape shape = static_cast<field_shape>(s);
+          ch->m_size[s] = make_plan(
+              ch->m_pack[s], make_offsets(src_sinfos, shape, si, ni, sj, nj));
+          make_plan(ch->m_unpack[s],
+                    make_offsets(dst_sinfos, shape, ri, ni, rj, nj));
+        }
+        ch->m_posted = 0;
+        ch->m_consumed = 0;
+
+        m_sends[src.m_index].push_back(ch.get());
+        m_receives[dst.m_index].push_back(ch.get());
+        m_channels.push_back(std::move(ch));
+      }
+  }
+}
+
+void halo_exchange::add_field(field_shape shape, std::size_t element_size,
+                              field_data_t data) {
+  if (m_started.load())
+    throw(std::runtime_error("Can not add a field to a started exchange"));
+  m_fields.push_back(field{shape, element_size, data});
+  for (auto &ch : m_channels)
+    ch->m_buffer.resize(ch->m_buffer.size() +
+                        ch->m_size[shape] * element_size);
+}
+
+std::size_t halo_exchange::bytes() const {
+  std::size_t res = 0;
+  for (auto const &ch : m_channels)
+    res += ch->m_buffer.size();
+  return res;
+}
+
+void halo_exchange::start(unsigned int tile) {
+  m_started.store(true, std::memory_order_relaxed);
+  for (channel *ch : m_sends.at(tile)) {
+    // the buffer is reused once the destination unpacked the last message
+    const unsigned long posted = ch->m_posted.load(std::memory_order_relaxed);
+    while (ch->m_consumed.load(std::memory_order_acquire) != posted)
+      std::this_thread::yield();
+
+    char *buf = ch->m_buffer.data();
+    for (field const &f : m_fields)
+      buf = pack(ch->m_pack[f.m_shape], f.m_element_size, f.m_data(tile), buf);
+    ch->m_posted.store(posted + 1, std::memory_order_release);
+  }
+}
+
+void halo_exchange::finish(unsigned int tile) {
+  for (channel *ch : m_receives.at(tile)) {
+    const unsigned long consumed =
+        ch->m_consumed.load(std::memory_order_relaxed);
+    while (ch->m_posted.load(std::memory_order_acquire) == consumed)
+      std::this_thread::yield();
+
+    char const *buf = ch->m_buffer.data();
+    for (field const &f : m_fields)
+      buf = unpack(ch->m_unpack[f.m_shape], f.m_element_size, buf,
+                   f.m_data(tile));
+    ch->m_consumed.store(consumed + 1, std::memory_order_release);
+  }
+}
+
+void halo_exchange::exchange() {
+  const int ntiles = m_sends.size();
+#pragma omp parallel
+  {
+#pragma omp for schedule(static) nowait
+    for (int t = 0; t < ntiles; ++t)
+      start(t);
+#pragma omp for schedule(static)
+    for (int t = 0; t < ntiles; ++t)
+      finish(t);
+  }
+}
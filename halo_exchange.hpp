@@ -0,0 +1,156 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#pragma once
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "tile.hpp"
+
+/**
+ * Update of the halos of a set of fields between the tiles of the domain.
+ * Each tile exchanges with its (up to 8) neighbors, the fields are packed
+ * in one message per neighbor. The pack/unpack plans (runs of contiguous
+ * elements of the regions sent and received by each tile) are computed once
+ * at construction, and the message buffers are allocated when the fields are
+ * added and reused by all the exchanges.
+ *
+ * start(tile) packs and posts the messages of a tile, finish(tile) waits for
+ * the messages of its neighbors and unpacks them into its halo, so that the
+ * interior of the tile can be computed in between. The messages go through
+ * shared memory, i.e. the tiles are exchanged among the threads of the
+ * process. A thread must start all its tiles before finishing any of them,
+ * e.g. with the same static schedule for the start and the finish loops.
+ * The halos on the boundaries of the whole domain are not updated.
+ */
+class halo_exchange {
+public:
+  typedef std::function<char *(unsigned int)> field_data_t;
+
+  // shapes of the fields with a horizontal halo, each with its own plans
+  enum field_shape : unsigned int {
+    shape_3d,
+    shape_3d_stag,
+    shape_2d,
+    shape_3d_column
+  };
+  static constexpr unsigned int num_shapes = 4;
+
+  halo_exchange(tiling const &tiles,
+                std::vector<tile_descriptor> const &descriptors);
+
+  halo_exchange(halo_exchange const &) = delete;
+  halo_exchange &operator=(halo_exchange const &) = delete;
+
+  // adds a field of a shape with elements of element_size bytes to the
+  // exchange, data returns the memory of the field of a tile. Fields can
+  // only be added before the first exchange
+  void add_field(field_shape shape, std::size_t element_size,
+                 field_data_t data);
+
+  unsigned int num_fields() const { return m_fields.size(); }
+
+  void start(unsigned int tile);
+  void finish(unsigned int tile);
+
+  // exchanges all the tiles, in parallel over the tiles
+  void exchange();
+
+  // messages and bytes sent by one exchange of all the tiles
+  unsigned int messages() const { return m_channels.size(); }
+  std::size_t bytes() const;
+
+private:
+  // contiguous elements of a region of a field
+  struct run {
+    int m_offset;
+    int m_count;
+  };
+  typedef std::vector<run> plan_t;
+
+  // messages from a tile to a neighbor, with the plans of the region packed
+  // by the source and of the halo unpacked by the destination.
+  // m_posted and m_consumed count the messages, the source waits until the
+  // last message is consumed before packing the next one in the buffer
+  struct channel {
+    unsigned int m_source, m_dest;
+    std::array<plan_t, num_shapes> m_pack, m_unpack;
+    std::array<std::size_t, num_shapes> m_size;
+    std::vector<char> m_buffer;
+    std::atomic<unsigned long> m_posted;
+    std::atomic<unsigned long> m_consumed;
+  };
+
+  struct field {
+    field_shape m_shape;
+    std::size_t m_element_size;
+    field_data_t m_data;
+  };
+
+  std::vector<field> m_fields;
+  std::vector<std::unique_ptr<channel>> m_channels;
+  // channels sent and received by each tile
+  std::vector<std::vector<channel *>> m_sends;
+  std::vector<std::vector<channel *>> m_receives;
+  std::atomic<bool> m_started;
+};
+
+// shape of the fields of a storage info in a halo exchange. The columns have
+// no horizontal halo
+template <typename StorageInfo> struct halo_shape {
+  static_assert(sizeof(StorageInfo) == 0, "The fields have no halo");
+};
+
+template <>
+struct halo_shape<storage_info_3d_t>
+    : std::integral_constant<halo_exchange::field_shape,
+                             halo_exchange::shape_3d> {};
+
+template <>
+struct halo_shape<storage_info_3d_stag_t>
+    : std::integral_constant<halo_exchange::field_shape,
+                             halo_exchange::shape_3d_stag> {};
+
+template <>
+struct halo_shape<storage_info_2d_t>
+    : std::integral_constant<halo_exchange::field_shape,
+                             halo_exchange::shape_2d> {};
+
+template <>
+struct halo_shape<storage_info_3d_column_t>
+    : std::integral_constant<halo_exchange::field_shape,
+                             halo_exchange::shape_3d_column> {};
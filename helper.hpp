@@ -35,6 +35,10 @@
 */
 
 #pragma once
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 template <typename T>
 constexpr unsigned int find_(unsigned int pos, T pattern, T val1) {
@@ -45,3 +49,159 @@ template <typename T, typename... Ts>
 constexpr unsigned int find_(unsigned int pos, T pattern, T val1, Ts... Vals) {
   return (pattern == val1) ? pos : find_(pos + 1, pattern, Vals...);
 }
+
+template <typename T, typename... Ts> struct is_one_of : std::false_type {};
+
+template <typename T, typename T1, typename... Ts>
+struct is_one_of<T, T1, Ts...>
+    : std::integral_constant<bool, std::is_same<T, T1>::value ||
+                                       is_one_of<T, Ts...>::value> {};
+
+template <typename... Ts> struct type_list {
+  static constexpr unsigned int size = sizeof...(Ts);
+};
+
+// position of T in a type_list
+template <typename T, typename List> struct index_of;
+
+template <typename T, typename... Ts>
+struct index_of<T, type_list<T, Ts...>>
+    : std::integral_constant<unsigned int, 0> {};
+
+template <typename T, typename U, typename... Ts>
+struct index_of<T, type_list<U, Ts...>>
+    : std::integral_constant<unsigned int,
+                             1 + index_of<T, type_list<Ts...>>::value> {};
+
+template <typename... Lists> struct concat_lists;
+
+template <> struct concat_lists<> { using type = type_list<>; };
+
+template <typename... Ts> struct concat_lists<type_list<Ts...>> {
+  using type = type_list<Ts...>;
+};
+
+template <typename... T1s, typename... T2s, typename... Rest>
+struct concat_lists<type_list<T1s...>, type_list<T2s...>, Rest...> {
+  using type =
+      typename concat_lists<type_list<T1s..., T2s...>, Rest...>::type;
+};
+
+template <std::size_t... Is> struct index_sequence {
+  static constexpr std::size_t size = sizeof...(Is);
+};
+
+template <typename S1, typename S2> struct merge_sequences;
+
+template <std::size_t... I1s, std::size_t... I2s>
+struct merge_sequences<index_sequence<I1s...>, index_sequence<I2s...>> {
+  using type = index_sequence<I1s..., (sizeof...(I1s) + I2s)...>;
+};
+
+// the sequence is built by halves, so that the depth of the template
+// recursion is logarithmic in N
+template <std::size_t N> struct make_index_sequence_impl {
+  using type = typename merge_sequences<
+      typename make_index_sequence_impl<N / 2>::type,
+      typename make_index_sequence_impl<N - N / 2>::type>::type;
+};
+
+template <> struct make_index_sequence_impl<0> {
+  using type = index_sequence<>;
+};
+
+template <> struct make_index_sequence_impl<1> {
+  using type = index_sequence<0>;
+};
+
+template <std::size_t N>
+using make_index_sequence = typename make_index_sequence_impl<N>::type;
+
+template <typename T, std::size_t> struct always { using type = T; };
+
+// type_list with N times T
+template <typename T, typename Seq> struct repeat_type_impl;
+
+template <typename T, std::size_t... Is>
+struct repeat_type_impl<T, index_sequence<Is...>> {
+  using type = type_list<typename always<T, Is>::type...>;
+};
+
+template <typename T, std::size_t N>
+using repeat_type = typename repeat_type_impl<T, make_index_sequence<N>>::type;
+
+template <std::size_t I, typename T> struct indexed_element { T m_value; };
+
+template <typename Seq, typename... Ts> struct indexed_tuple_impl;
+
+template <std::size_t... Is, typename... Ts>
+struct indexed_tuple_impl<index_sequence<Is...>, Ts...>
+    : indexed_element<Is, Ts>... {};
+
+// tuple whose elements are all direct bases. Unlike std::tuple, accessing an
+// element does not walk a recursive chain of N base classes, which dominates
+// the compile time of tuples with hundreds of elements
+template <typename... Ts>
+struct indexed_tuple
+    : indexed_tuple_impl<make_index_sequence<sizeof...(Ts)>, Ts...> {};
+
+template <std::size_t I, typename T>
+T &get_element(indexed_element<I, T> &element) {
+  return element.m_value;
+}
+
+template <std::size_t I, typename T>
+always<T, I> element_type(indexed_element<I, T> const &);
+
+// I-th type of a type_list, looked up among the bases of an indexed_tuple
+template <std::size_t I, typename List> struct type_at;
+
+template <std::size_t I, typename... Ts> struct type_at<I, type_list<Ts...>> {
+  using type = typename decltype(
+      element_type<I>(std::declval<indexed_tuple<Ts...>>()))::type;
+};
+
+template <typename F, std::size_t... Is>
+void for_each_index_impl(F &f, index_sequence<Is...>) {
+  int expand[] = {0, (f(std::integral_constant<int, Is>()), 0)...};
+  (void)expand;
+}
+
+// calls f(std::integral_constant<int, I>()) for I in [0, N)
+template <std::size_t N, typename F> void for_each_index(F f) {
+  for_each_index_impl(f, make_index_sequence<N>());
+}
+
+constexpr int first_found(int pos1, int pos2) {
+  return (pos1 >= 0) ? pos1 : pos2;
+}
+
+// position of the first true value, -1 if none
+constexpr int first_true(int) { return -1; }
+
+template <typename... Bs>
+constexpr int first_true(int pos, bool b, Bs... bs) {
+  return b ? pos : first_true(pos + 1, bs...);
+}
+
+// sum of the first n values
+constexpr unsigned int sum_first(unsigned int) { return 0; }
+
+template <typename... Ts>
+constexpr unsigned int sum_first(unsigned int n, unsigned int v, Ts... vs) {
+  return n ? v + sum_first(n - 1, vs...) : 0;
+}
+
+// position of val in the range [first, last) of values, -1 if not found.
+// The range is split in halves to keep the constexpr recursion depth
+// logarithmic in the number of values
+constexpr int find_value(long const *values, long val, unsigned int first,
+                         unsigned int last) {
+  return (first >= last)
+             ? -1
+             : (last - first == 1)
+                   ? ((values[first] == val) ? (int)first : -1)
+                   : first_found(
+                         find_value(values, val, first, (first + last) / 2),
+                         find_value(values, val, (first + last) / 2, last));
+}
@@ -35,7 +35,11 @@
 */
 
 #include <stencil-composition/stencil-composition.hpp>
+#include <cstdlib>
+#include <string>
+#include <iostream>
 #include "field_pool.hpp"
+#include "task_graph.hpp"
 
 template <typename... F> std::tuple<F &&...> input(F &&... f) {
   return std::forward_as_tuple(f...);
@@ -45,95 +49,213 @@ template <typename... F> std::tuple<F &&...> output(F &&... f) {
   return std::forward_as_tuple(f...);
 }
 
+// binds the (First + I)-th input/output pair to the data/datatens
+// placeholders of the I-th field of the batched vertical advection, and
+// returns the sum of the generations of the bindings
+template <unsigned int First, unsigned int I, unsigned int N>
+struct bind_vadvect_batch {
+  template <typename InputTuple, typename OutputTuple>
+  static unsigned long apply(field_pool &fpool, InputTuple &it,
+                             OutputTuple &ot) {
+    return fpool.bind_arg<vadvect_batch, vadvect_data(I)>(
+               std::get<First + I>(it)) +
+           fpool.bind_arg<vadvect_batch, vadvect_datatens(I)>(
+               std::get<First + I>(ot)) +
+           bind_vadvect_batch<First, I + 1, N>::apply(fpool, it, ot);
+  }
+};
+
+template <unsigned int First, unsigned int N>
+struct bind_vadvect_batch<First, N, N> {
+  template <typename InputTuple, typename OutputTuple>
+  static unsigned long apply(field_pool &, InputTuple &, OutputTuple &) {
+    return 0;
+  }
+};
+
 struct vertical_advection {
 
-  vertical_advection() {
+  vertical_advection() : m_batch_generations() {
     field_pool &fpool = field_pool::get_instance();
 
-    // we create the placeholders that later we will bind to actual storages
-    // This stencil can be applied to multiple prognostic fields, therefore
-    // it defines a specific context, vadvect, that defines joker placeholder
-    // that can be bound to different prognostic field storages (u,v,w...)
-    auto p_data = fpool.get_arg<vadvect, vadvect::data>();
-    auto p_fc = fpool.get_arg<vadvect, vadvect::fc>();
-    auto p_data_tens = fpool.get_arg<vadvect, vadvect::datatens>();
+    // The operator processes N prognostic fields in a single pass over the
+    // columns: the functor loads fc and sets up each column once, and then
+    // advects the N fields. It defines a specific context, vadvect_batch,
+    // whose joker placeholders can be bound to different prognostic field
+    // storages (u,v,w...). One computation is built per batch size, using
+    // the first N data/datatens placeholders
+    auto p_batch_fc = fpool.get_arg<vadvect_batch, vadvect_fc()>();
     // Not all fields will be passed by args to the stencil workflow.
     // Constant fields are bound at initialization, and not changed
-    // through the run of the model. Therefore in the example below,
-    // hdmask is not a placeholder specific to the vertical advection context
-    // but belongs instead to the dycore as a global prognostic field
+    // through the run of the model. Therefore hdmask is not a placeholder
+    // specific to the vertical advection context but belongs instead to the
+    // dycore as a global prognostic field
     auto p_hdmask = fpool.get_arg<dycore_param, dycore_param::hdmask>();
 
-    //    gridtools::aggregator_type<  > domain(p_data(), p_fc(), p_data_tens(),
-    //    p_hdmask());
-
-    //    m_stencil = gridtools::make_computation<gridtools::BACKEND>(
-    //        domain, grid,
-    //        gridtools::make_multistage // mss_descriptor
+    //    for N in [1, vadvect_batch_size]
+    //      m_batch_stencils[N-1] = gridtools::make_computation<BACKEND>(
+    //        domain_N, grid,
+    //        gridtools::make_multistage
     //        (execute<forward>(),
-    //         gridtools::make_stage<vadvt_functor>(....)));
+    //         gridtools::make_stage<vadvt_batch_functor<N>>(....)));
   }
 
+  // applies the operator to N prognostic fields, in batches of up to
+  // vadvect_batch_size fields processed in a single pass. The inputs are the
+  // N fields followed by fc, and the outputs the N tendencies
   template <typename InputTuple, typename OutputTuple>
-  void single_vertical_advection(InputTuple &&it, OutputTuple &&ot) {
-    field_pool &fpool = field_pool::get_instance();
-
-    auto in = std::get<0>(it);
-    auto fc = std::get<1>(it);
-    auto out = std::get<0>(ot);
-    // here we bind the placeholders of the vadv stencil to the actual
-    // parameters passed
-    fpool.bind_arg<vadvect, vadvect::data>(in);
-    fpool.bind_arg<vadvect, vadvect::fc>(fc);
-    fpool.bind_arg<vadvect, vadvect::datatens>(out);
-
-    // and run the stencil
-    //    m_stencil->run();
+  void run(InputTuple &&it, OutputTuple &&ot) {
+    FIELD_POOL_TRACE_SCOPE("operator", "vertical_advection");
+
+    constexpr unsigned int nfields =
+        std::tuple_size<typename std::decay<OutputTuple>::type>::value;
+    GRIDTOOLS_STATIC_ASSERT(
+        (std::tuple_size<typename std::decay<InputTuple>::type>::value ==
+         nfields + 1),
+        "vertical advection expects one input per output, followed by fc");
+    GRIDTOOLS_STATIC_ASSERT((nfields > 0),
+                            "vertical advection expects at least one field");
+    run_batches<0, nfields>(it, ot);
   }
 
-  template <typename InputTuple, typename OutputTuple>
-  void run(InputTuple &&it, OutputTuple &&ot) {
+private:
+  // runs the fields [First, N) in batches of vadvect_batch_size fields, the
+  // last one possibly smaller
+  template <unsigned int First, unsigned int N, typename InputTuple,
+            typename OutputTuple>
+  typename std::enable_if<(First < N)>::type run_batches(InputTuple &it,
+                                                         OutputTuple &ot) {
     field_pool &fpool = field_pool::get_instance();
-
-    // we unpack the multiple fields to which we apply this operator
-    auto u = std::get<0>(it);
-    auto v = std::get<1>(it);
-    auto w = std::get<2>(it);
-    auto fc = std::get<3>(it);
-
-    auto utens = std::get<0>(ot);
-    auto vtens = std::get<1>(ot);
-    auto wtens = std::get<2>(ot);
-
-    // and call the vertical advection operator for each prognostic field
-    single_vertical_advection(input(u, fc), output(utens));
-    single_vertical_advection(input(v, fc), output(vtens));
-    single_vertical_advection(input(w, fc), output(wtens));
+    constexpr unsigned int size =
+        (N - First < vadvect_batch_size) ? N - First : vadvect_batch_size;
+
+    // fc is bound once for the whole batch, and the multiple fields to which
+    // we apply this operator are bound to the placeholders of the batch.
+    // Placeholders already bound to the same storages are not modified, and
+    // keep their generation
+    const unsigned long generation =
+        fpool.bind_arg<vadvect_batch, vadvect_fc()>(std::get<N>(it)) +
+        bind_vadvect_batch<First, 0, size>::apply(fpool, it, ot);
+
+    // the domain of the stencil is only set up again when one of its
+    // placeholders was bound to a different storage (i.e. always when
+    // consecutive batches of a run have the same size)
+    if (generation != m_batch_generations[size - 1]) {
+      //    m_batch_stencils[size - 1]->reassign(...);
+      m_batch_generations[size - 1] = generation;
+    }
+
+    // and run the fused stencil once for all the fields of the batch
+    //    m_batch_stencils[size - 1]->run();
+
+    run_batches<First + size, N>(it, ot);
   }
 
-private:
-  std::shared_ptr<gridtools::computation<void>> m_stencil;
+  template <unsigned int First, unsigned int N, typename InputTuple,
+            typename OutputTuple>
+  typename std::enable_if<(First >= N)>::type run_batches(InputTuple &,
+                                                          OutputTuple &) {}
+
+  std::array<std::shared_ptr<gridtools::computation<void>>,
+             vadvect_batch_size> m_batch_stencils;
+  // sum of the generations of the placeholders of each stencil when its
+  // domain was last set up
+  std::array<unsigned long, vadvect_batch_size> m_batch_generations;
 };
 
 void fast_waves_sc() {
+  FIELD_POOL_TRACE_SCOPE("operator", "fast_waves_sc");
   field_pool &fpool = field_pool::get_instance();
 
   // we enter into the fast waves context, from this point on we can request
-  // fields associated with the fast waves context
-  fpool.activate_context<fast_waves_sc_param>();
+  // fields associated with the fast waves context. The context is
+  // deactivated when the guard goes out of scope
+  auto fw_context = fpool.enter_context<fast_waves_sc_param>();
 
   // we do an initial binding of the fast waves placholders to storages.
   fpool.bind_all_args<fw_sc_repo_info_t>();
 
-  auto lgsA = fpool.get_st<fast_waves_sc_param, fast_waves_sc_param::lgsA>();
+  // fields accessed through the guard are checked at compile time, and
+  // accessed by reference, without copying the data store
+  auto &lgsA = fpool.get_st<fast_waves_sc_param, fast_waves_sc_param::lgsA>(
+      fw_context);
+  fpool.bind_arg<fast_waves_sc_param, fast_waves_sc_param::lgsA>(lgsA);
+}
+
+// the intermediate fields of the horizontal diffusion are placed in the
+// memory the fast waves used, that is no longer active
+void horizontal_diffusion() {
+  FIELD_POOL_TRACE_SCOPE("operator", "horizontal_diffusion");
+  field_pool &fpool = field_pool::get_instance();
+  auto hdiff_context = fpool.enter_context<hdiff_param>();
+  fpool.bind_all_args<hdiff_repo_info_t>();
 
-  fpool.deactivate_context<fast_waves_sc_param>();
+  //  m_hdiff_stencil->run();
 }
 
 int main(int argc, char **argv) {
 
+  // the domain can be passed as:
+  //   proto_dycore [nx ny nz [halo [alignment [allocation [output]]]]]
+  // where allocation is one of per_field, arena, arena_huge_pages, and
+  // output the prefix of the files of the diagnostics
+  unsigned int nx = 10, ny = 10, nz = 10, halo = 3, alignment = 1;
+  allocation_mode mode = allocation_mode::per_field;
+  if (argc > 3) {
+    nx = std::stoi(argv[1]);
+    ny = std::stoi(argv[2]);
+    nz = std::stoi(argv[3]);
+  }
+  if (argc > 4)
+    halo = std::stoi(argv[4]);
+  if (argc > 5)
+    alignment = std::stoi(argv[5]);
+  if (argc > 6) {
+    const std::string alloc(argv[6]);
+    if (alloc == "arena")
+      mode = allocation_mode::arena;
+    else if (alloc == "arena_huge_pages")
+      mode = allocation_mode::arena_huge_pages;
+    else if (alloc != "per_field")
+      throw(std::runtime_error("Unknown allocation mode " + alloc));
+  }
+  const std::string output_prefix = (argc > 7) ? argv[7] : "";
+
+  // the field pool is initialized once with the grid, all the storages of
+  // all the repositories are sized from it
+  field_pool &fpool = field_pool::initialize(
+      grid_descriptor(nx, ny, nz, halo, alignment), mode);
+
+  // the fast waves and the dycore contexts are nested, therefore they can not
+  // be aliased. The horizontal diffusion runs after the fast waves, their
+  // lifetimes never overlap and they share the same memory
+  fpool.alias_contexts<fast_waves_sc_param, hdiff_param>();
+  std::cout << fpool.plan_memory() << std::endl;
+
+  // the memory accounting of the contexts and fields is written as JSON at
+  // exit, if a file is given in PROTO_DYCORE_STATS
+  if (char const *stats_path = std::getenv("PROTO_DYCORE_STATS"))
+    fpool.write_stats_at_exit(stats_path);
+
+  // fields that are not known at compile time are registered by name at
+  // setup, and belong to one of the contexts
+  fpool.register_field<dycore_param, data_store_3d_t>("qv");
+
+  // tracers are added at setup as well, and are stored as a single bundle
+  fpool.add_tracer<dycore_param>("qc");
+  fpool.add_tracer<dycore_param>("qr");
+
+  // diagnostics are snapshot into staging buffers, and written by a
+  // background thread while the next time step runs
+  if (!output_prefix.empty()) {
+    fpool.set_output(output_prefix);
+    fpool.add_output<dycore_param, dycore_param::u>("u");
+    fpool.add_output<dycore_param, dycore_param::v>("v");
+    fpool.add_output<dycore_param, dycore_param::w>("w");
+    fpool.add_output<dycore_param, dycore_param::tp>("tp");
+  }
+
   vertical_advection va;
-  field_pool &fpool = field_pool::get_instance();
 
   fpool.activate_context<dycore_param>();
 
@@ -154,8 +276,24 @@ int main(int argc, char **argv) {
   auto utens = fpool.get_st<dycore_param, dycore_param::utens>();
   auto vtens = fpool.get_st<dycore_param, dycore_param::vtens>();
   auto wtens = fpool.get_st<dycore_param, dycore_param::wtens>();
-
-  va.run(input(u, v, w, fc), output(utens, vtens, wtens));
+  auto qv = fpool.get_st<data_store_3d_t>("qv");
+  // tracers can be accessed one by one, or as a 4d bundle
+  auto qc = fpool.get_tracers<dycore_param>().get_tracer("qc");
+  auto tracers = fpool.get_tracers<dycore_param>().get_bundle();
+
+  // operators are recorded in a task graph together with the fields they
+  // read and write, and independent operators run concurrently. The
+  // operator itself is passed as an output, since all its calls bind the
+  // same placeholders
+  thread_pool pool;
+  task_graph graph;
+  graph.add(
+      [&]() { va.run(input(u, v, w, fc), output(utens, vtens, wtens)); },
+      input(u, v, w, fc), output(utens, vtens, wtens, va));
+  graph.run(pool);
+
+  if (!output_prefix.empty())
+    fpool.write_output(0);
 
   // The folowing access will throw an exception, since we did not create yet
   // the context of the fast waves sc. Field access in a scope out of the
@@ -166,8 +304,22 @@ int main(int argc, char **argv) {
   //  fast_waves_sc_param::lgsA>();
 
   fast_waves_sc();
+  horizontal_diffusion();
+
+  // end of the time step: the new time level of the prognostic fields
+  // becomes the current one, by swapping their storages
+  fpool.rotate_time_levels<dycore_param>();
+
+  // pending diagnostics are written before leaving the model
+  if (!output_prefix.empty())
+    fpool.get_output().flush();
 
   // we get out of the dycore context. Beyong this line we can not access any
   // dycore prognostic field
   fpool.deactivate_context<dycore_param>();
+
+  // the timeline of the contexts and operators (when built with
+  // FIELD_POOL_TRACE) can be loaded in chrome://tracing
+  if (char const *trace_path = std::getenv("PROTO_DYCORE_TRACE"))
+    trace_recorder::instance().write_chrome_trace(trace_path);
 }
@@ -0,0 +1,174 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#include "output_stage.hpp"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+output_stage::output_stage(std::string const &prefix, unsigned int nbuffers)
+    : m_prefix(prefix), m_bytes(0), m_buffers(nbuffers ? nbuffers : 1),
+      m_stop(false), m_stalls(0), m_written(0) {
+  for (unsigned int i = 0; i < m_buffers.size(); ++i)
+    m_free.push_back(i);
+  m_writer = std::thread(&output_stage::writer_loop, this);
+}
+
+output_stage::~output_stage() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_queued_cv.notify_all();
+  m_writer.join();
+}
+
+void output_stage::add_field(std::string const &name, std::size_t bytes,
+                             std::function<char const *()> data) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_buffers.front().m_data.empty())
+    throw(std::runtime_error("Can not add the output field " + name +
+                             " after the first snapshot"));
+  m_fields.push_back(field{name, bytes, m_bytes, data});
+  m_bytes += bytes;
+}
+
+void output_stage::snapshot(unsigned long step) {
+  unsigned int index;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    rethrow_write_error();
+    if (m_free.empty()) {
+      ++m_stalls;
+      m_free_cv.wait(lock, [this]() { return !m_free.empty() || m_exception; });
+      rethrow_write_error();
+    }
+    index = m_free.front();
+    m_free.pop_front();
+  }
+
+  // the buffer is owned by the caller until it is queued, and given back if
+  // a field can not be copied (e.g. its context is not active)
+  buffer &buf = m_buffers[index];
+  try {
+    buf.m_data.resize(m_bytes);
+    buf.m_step = step;
+    for (field const &f : m_fields)
+      std::memcpy(buf.m_data.data() + f.m_offset, f.m_data(), f.m_bytes);
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_free.push_front(index);
+    }
+    m_free_cv.notify_all();
+    throw;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queued.push_back(index);
+  }
+  m_queued_cv.notify_one();
+}
+
+void output_stage::flush() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_free_cv.wait(lock, [this]() {
+    return m_free.size() == m_buffers.size() || m_exception;
+  });
+  rethrow_write_error();
+}
+
+void output_stage::rethrow_write_error() {
+  if (!m_exception)
+    return;
+  std::exception_ptr exception = m_exception;
+  m_exception = nullptr;
+  std::rethrow_exception(exception);
+}
+
+unsigned long output_stage::stalls() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stalls;
+}
+
+unsigned long output_stage::written() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_written;
+}
+
+void output_stage::writer_loop() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_queued_cv.wait(lock, [this]() { return m_stop || !m_queued.empty(); });
+    if (m_queued.empty())
+      return;
+    const unsigned int index = m_queued.front();
+    m_queued.pop_front();
+
+    lock.unlock();
+    std::exception_ptr exception;
+    try {
+      write(m_buffers[index]);
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    lock.lock();
+
+    if (exception && !m_exception)
+      m_exception = exception;
+    if (!exception)
+      ++m_written;
+    m_free.push_back(index);
+    m_free_cv.notify_all();
+  }
+}
+
+void output_stage::write(buffer const &buf) const {
+  const std::string path =
+      m_prefix + "_" + std::to_string(buf.m_step) + ".out";
+  std::ofstream out(path, std::ios::binary);
+  for (field const &f : m_fields) {
+    const std::uint64_t length = f.m_name.size(), bytes = f.m_bytes;
+    out.write(reinterpret_cast<char const *>(&length), sizeof(length));
+    out.write(f.m_name.data(), length);
+    out.write(reinterpret_cast<char const *>(&bytes), sizeof(bytes));
+    out.write(buf.m_data.data() + f.m_offset, f.m_bytes);
+  }
+  out.close();
+  if (!out)
+    throw(std::runtime_error("Can not write the output file " + path));
+}
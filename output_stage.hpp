@@ -0,0 +1,123 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Asynchronous output of a set of fields. A snapshot copies the fields into
+ * a staging buffer, and a background writer thread serializes the buffer to
+ * <prefix>_<step>.out while the model goes on. The staging buffers (two by
+ * default) are allocated at the first snapshot and reused afterwards. If all
+ * of them are still being written, the snapshot waits for the writer
+ * (back pressure) instead of allocating more memory.
+ *
+ * Each file contains, for each field, the length of its name, the name, the
+ * number of bytes of the field and its data.
+ */
+class output_stage {
+public:
+  explicit output_stage(std::string const &prefix, unsigned int nbuffers = 2);
+  // writes the pending snapshots before stopping the writer
+  ~output_stage();
+
+  output_stage(output_stage const &) = delete;
+  output_stage &operator=(output_stage const &) = delete;
+
+  // adds a field to the output, data returns the memory of the field at the
+  // time of the snapshot. Fields can only be added before the first snapshot
+  void add_field(std::string const &name, std::size_t bytes,
+                 std::function<char const *()> data);
+
+  unsigned int num_fields() const { return m_fields.size(); }
+
+  // copies the fields into a free staging buffer, and queues it for writing.
+  // If an earlier write failed, its exception is rethrown. If the data of a
+  // field throws, the buffer is freed and the exception is propagated
+  void snapshot(unsigned long step);
+
+  // waits until all the queued snapshots are written. If a write failed,
+  // its exception is rethrown
+  void flush();
+
+  // number of snapshots that had to wait for a free staging buffer
+  unsigned long stalls() const;
+  unsigned long written() const;
+
+private:
+  struct field {
+    std::string m_name;
+    std::size_t m_bytes;
+    std::size_t m_offset;
+    std::function<char const *()> m_data;
+  };
+
+  struct buffer {
+    std::vector<char> m_data;
+    unsigned long m_step;
+  };
+
+  void writer_loop();
+  void write(buffer const &buf) const;
+  // rethrows the exception of a failed write, that is only reported once:
+  // the stage keeps writing the next snapshots. Called with m_mutex held
+  void rethrow_write_error();
+
+  std::string m_prefix;
+  std::vector<field> m_fields;
+  std::size_t m_bytes;
+  std::vector<buffer> m_buffers;
+  // indices of the buffers that are free, and of the ones waiting to be
+  // written (in order of the snapshots)
+  std::deque<unsigned int> m_free;
+  std::deque<unsigned int> m_queued;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_free_cv;
+  std::condition_variable m_queued_cv;
+  bool m_stop;
+  unsigned long m_stalls;
+  unsigned long m_written;
+  std::exception_ptr m_exception;
+  std::thread m_writer;
+};
@@ -35,11 +35,11 @@
 */
 
 #pragma once
-#include <boost/mpl/set_c.hpp>
-#include <boost/mpl/vector_c.hpp>
+#include <array>
 #include "storage-facility.hpp"
 #include <stencil-composition/stencil-composition.hpp>
 #include "helper.hpp"
+#include "repo_info.hpp"
 
 #ifdef __CUDACC__
 #define BACKEND_ARCH gridtools::enumtype::Cuda
@@ -55,46 +55,223 @@
 
 typedef gridtools::storage_traits<BACKEND_ARCH>::storage_info_t<0, 3>
     storage_info_3d_t;
-typedef gridtools::storage_traits<BACKEND_ARCH>::data_store_t<
-    gridtools::float_type, storage_info_3d_t> data_store_3d_t;
-
 typedef gridtools::storage_traits<BACKEND_ARCH>::storage_info_t<0, 2>
     storage_info_2d_t;
+// staggered 3d fields, defined on the nz + 1 interfaces of the levels
+typedef gridtools::storage_traits<BACKEND_ARCH>::storage_info_t<1, 3>
+    storage_info_3d_stag_t;
+// columns that only vary along k (i.e. reference profiles). The i and j
+// dimensions are masked, so that they are accessed like 3d fields in the
+// stencils but only hold nz elements
+typedef gridtools::storage_traits<BACKEND_ARCH>::special_storage_info_t<
+    0, gridtools::selector<0, 0, 1>> storage_info_1d_t;
+// 3d fields with k contiguous whatever the backend, for the operators that
+// stream along the columns (i.e. the vertical implicit solvers)
+typedef gridtools::layout_map<0, 1, 2> layout_column_t;
+typedef gridtools::storage_traits<BACKEND_ARCH>::custom_layout_storage_info_t<
+    2, layout_column_t> storage_info_3d_column_t;
+
+// layout of the 3d storages of the backend, k is only contiguous on the host
+#ifdef __CUDACC__
+typedef gridtools::layout_map<2, 1, 0> layout_3d_t;
+#else
+typedef gridtools::layout_map<0, 1, 2> layout_3d_t;
+#endif
+
+// layout of the storages of the 3d storage infos
+template <typename StorageInfo> struct storage_layout;
+template <> struct storage_layout<storage_info_3d_t> {
+  using type = layout_3d_t;
+};
+template <> struct storage_layout<storage_info_3d_column_t> {
+  using type = layout_column_t;
+};
+
+// storages of a shape with a given precision. A repo_info can map each field
+// to any data store type, e.g. data_store_3d<float> for the fields that can
+// be stored in single precision
+template <typename T>
+using data_store_3d = gridtools::storage_traits<
+    BACKEND_ARCH>::data_store_t<T, storage_info_3d_t>;
+template <typename T>
+using data_store_2d = gridtools::storage_traits<
+    BACKEND_ARCH>::data_store_t<T, storage_info_2d_t>;
+template <typename T>
+using data_store_3d_stag = gridtools::storage_traits<
+    BACKEND_ARCH>::data_store_t<T, storage_info_3d_stag_t>;
+template <typename T>
+using data_store_1d = gridtools::storage_traits<
+    BACKEND_ARCH>::data_store_t<T, storage_info_1d_t>;
+template <typename T>
+using data_store_3d_column = gridtools::storage_traits<
+    BACKEND_ARCH>::data_store_t<T, storage_info_3d_column_t>;
+
+typedef data_store_3d<gridtools::float_type> data_store_3d_t;
+typedef data_store_2d<gridtools::float_type> data_store_2d_t;
+typedef data_store_3d<float> data_store_3d_float_t;
+typedef data_store_2d<float> data_store_2d_float_t;
+typedef data_store_3d_stag<gridtools::float_type> data_store_3d_stag_t;
+typedef data_store_1d<gridtools::float_type> data_store_1d_t;
+typedef data_store_3d_column<gridtools::float_type> data_store_3d_column_t;
+
+// storage infos of all the shapes, owned by the field pool
+typedef storage_info_set<storage_info_3d_t, storage_info_2d_t,
+                         storage_info_3d_stag_t, storage_info_1d_t,
+                         storage_info_3d_column_t>
+    storage_infos_t;
+
+// sizes of the dimensions of a storage info, 1 for the missing ones
+inline std::array<unsigned int, 3> storage_shape(storage_info_3d_t const &s) {
+  return {{(unsigned int)s.template dim<0>(), (unsigned int)s.template dim<1>(),
+           (unsigned int)s.template dim<2>()}};
+}
+
+inline std::array<unsigned int, 3> storage_shape(storage_info_2d_t const &s) {
+  return {{(unsigned int)s.template dim<0>(), (unsigned int)s.template dim<1>(),
+           1}};
+}
+
+inline std::array<unsigned int, 3>
+storage_shape(storage_info_3d_stag_t const &s) {
+  return {{(unsigned int)s.template dim<0>(), (unsigned int)s.template dim<1>(),
+           (unsigned int)s.template dim<2>()}};
+}
+
+inline std::array<unsigned int, 3> storage_shape(storage_info_1d_t const &s) {
+  return {{1, 1, (unsigned int)s.template dim<2>()}};
+}
+
+inline std::array<unsigned int, 3>
+storage_shape(storage_info_3d_column_t const &s) {
+  return {{(unsigned int)s.template dim<0>(), (unsigned int)s.template dim<1>(),
+           (unsigned int)s.template dim<2>()}};
+}
+
+// The tracers of a context are stored in a single allocation where the
+// tracer index is the outermost dimension, so that each tracer can also be
+// accessed as a 3d field with the layout of data_store_3d_t
+#ifdef __CUDACC__
+typedef gridtools::layout_map<3, 2, 1, 0> layout_tracer_t;
+#else
+typedef gridtools::layout_map<1, 2, 3, 0> layout_tracer_t;
+#endif
+typedef gridtools::storage_traits<BACKEND_ARCH>::custom_layout_storage_info_t<
+    1, layout_tracer_t> storage_info_tracer_t;
 typedef gridtools::storage_traits<BACKEND_ARCH>::data_store_t<
-    gridtools::float_type, storage_info_2d_t> data_store_2d_t;
-
-enum class dycore_param { u, v, w, tp, fc, utens, vtens, wtens, hdmask };
-using dycore_repo_info_t = boost::mpl::map<
-    boost::mpl::pair<
-        data_store_3d_t,
-        boost::mpl::vector_c<
-            dycore_param, (long int)dycore_param::u, (long int)dycore_param::v,
-            (long int)dycore_param::w, (long int)dycore_param::tp,
-            (long int)dycore_param::utens, (long int)dycore_param::vtens,
-            (long int)dycore_param::wtens, (long int)dycore_param::hdmask>>,
-    boost::mpl::pair<
-        data_store_2d_t,
-        boost::mpl::vector_c<dycore_param, (long int)dycore_param::fc>>>;
-
-enum class fast_waves_sc_param { lgsA, lgsB, lgsC, lgsRHS, rCosPhi };
-using fw_sc_repo_info_t = boost::mpl::map<
-    boost::mpl::pair<
-        data_store_3d_t,
-        boost::mpl::vector_c<fast_waves_sc_param,
-                             (long int)fast_waves_sc_param::lgsA,
-                             (long int)fast_waves_sc_param::lgsB,
-                             (long int)fast_waves_sc_param::lgsC,
-                             (long int)fast_waves_sc_param::lgsRHS,
-                             (long int)fast_waves_sc_param::rCosPhi>>,
-    boost::mpl::pair<
-        data_store_2d_t,
-        boost::mpl::vector_c<fast_waves_sc_param,
-                             (long int)fast_waves_sc_param::rCosPhi>>>;
+    gridtools::float_type, storage_info_tracer_t> data_store_tracer_t;
+
+// hhl: height of the half levels, p0: reference pressure profile. The
+// prognostic fields have two time levels (now and new), while the masks and
+// the reference state are constant, and shared by the members of an ensemble.
+// The tendencies are stored in single precision
+enum class dycore_param {
+  u,
+  v,
+  w,
+  tp,
+  fc,
+  utens,
+  vtens,
+  wtens,
+  hdmask,
+  hhl,
+  p0
+};
+// name of a field in the stats, in the order of the enum
+inline char const *param_name(dycore_param param) {
+  static char const *names[] = {"u",     "v",     "w",     "tp",
+                                "fc",    "utens", "vtens", "wtens",
+                                "hdmask", "hhl",  "p0"};
+  return names[static_cast<int>(param)];
+}
+
+using dycore_repo_info_t = repo_info<
+    time_levels<2, fields<data_store_3d_t, dycore_param, dycore_param::u,
+                          dycore_param::v, dycore_param::w, dycore_param::tp>>,
+    fields<data_store_3d_float_t, dycore_param, dycore_param::utens,
+           dycore_param::vtens, dycore_param::wtens>,
+    constant_fields<
+        fields<data_store_3d_t, dycore_param, dycore_param::hdmask>>,
+    constant_fields<fields<data_store_2d_t, dycore_param, dycore_param::fc>>,
+    constant_fields<
+        fields<data_store_3d_stag_t, dycore_param, dycore_param::hhl>>,
+    constant_fields<fields<data_store_1d_t, dycore_param, dycore_param::p0>>>;
+
+// the fast waves solve implicitly along the columns, their 3d fields are
+// stored with k contiguous, including their copy of the vertical wind w. The
+// metric term rCosPhi only depends on the latitude, and is constant
+enum class fast_waves_sc_param { lgsA, lgsB, lgsC, lgsRHS, rCosPhi, w };
+inline char const *param_name(fast_waves_sc_param param) {
+  static char const *names[] = {"lgsA", "lgsB",    "lgsC",
+                                "lgsRHS", "rCosPhi", "w"};
+  return names[static_cast<int>(param)];
+}
+
+using fw_sc_repo_info_t = repo_info<
+    fields<data_store_3d_column_t, fast_waves_sc_param,
+           fast_waves_sc_param::lgsA, fast_waves_sc_param::lgsB,
+           fast_waves_sc_param::lgsC, fast_waves_sc_param::lgsRHS,
+           fast_waves_sc_param::w>,
+    constant_fields<fields<data_store_2d_t, fast_waves_sc_param,
+                           fast_waves_sc_param::rCosPhi>>>;
+
+// w is transposed from the dycore when the fast waves are entered, and back
+// when they are left
+template <> struct context_imports<fast_waves_sc_param> {
+  using type = type_list<imported_field<dycore_param, dycore_param::w,
+                                        fast_waves_sc_param,
+                                        fast_waves_sc_param::w>>;
+};
+
+// the horizontal diffusion runs after the fast waves, on its own
+// intermediate fields (laplacian and fluxes). It does not import any field,
+// and is never active together with the fast waves, so that both contexts
+// can be aliased
+enum class hdiff_param { lap, flx, fly };
+inline char const *param_name(hdiff_param param) {
+  static char const *names[] = {"lap", "flx", "fly"};
+  return names[static_cast<int>(param)];
+}
+
+using hdiff_repo_info_t =
+    repo_info<fields<data_store_3d_t, hdiff_param, hdiff_param::lap,
+                     hdiff_param::flx, hdiff_param::fly>>;
 
 enum class vadvect { data, datatens, fc };
-using list_vadvect_params = boost::mpl::map<
-    boost::mpl::pair<data_store_3d_t,
-                     boost::mpl::vector_c<vadvect, (long int)vadvect::data,
-                                          (long int)vadvect::datatens>>,
-    boost::mpl::pair<data_store_2d_t,
-                     boost::mpl::vector_c<vadvect, (long int)vadvect::fc>>>;
+using list_vadvect_params =
+    repo_info<fields<data_store_3d_t, vadvect, vadvect::data>,
+              fields<data_store_3d_float_t, vadvect, vadvect::datatens>,
+              fields<data_store_2d_t, vadvect, vadvect::fc>>;
+
+// batched vertical advection, that processes up to vadvect_batch_size
+// prognostic fields in one pass over the columns. The batch size is set at
+// compile time (VADVECT_BATCH_SIZE, CMake option PROTO_DYCORE_VADVECT_BATCH),
+// and the placeholders of the batch are generated from it: the data and
+// datatens placeholders of each field of the batch, followed by fc
+#ifndef VADVECT_BATCH_SIZE
+#define VADVECT_BATCH_SIZE 3
+#endif
+constexpr unsigned int vadvect_batch_size = VADVECT_BATCH_SIZE;
+static_assert(vadvect_batch_size > 0, "Empty vertical advection batch");
+
+enum class vadvect_batch : unsigned int {};
+constexpr vadvect_batch vadvect_data(unsigned int field) {
+  return static_cast<vadvect_batch>(field);
+}
+constexpr vadvect_batch vadvect_datatens(unsigned int field) {
+  return static_cast<vadvect_batch>(vadvect_batch_size + field);
+}
+constexpr vadvect_batch vadvect_fc() {
+  return static_cast<vadvect_batch>(2 * vadvect_batch_size);
+}
+template <typename Fields> struct vadvect_batch_params;
+template <std::size_t... Fields>
+struct vadvect_batch_params<index_sequence<Fields...>> {
+  using type = repo_info<
+      fields<data_store_3d_t, vadvect_batch, vadvect_data(Fields)...>,
+      fields<data_store_3d_float_t, vadvect_batch,
+             vadvect_datatens(Fields)...>,
+      fields<data_store_2d_t, vadvect_batch, vadvect_fc()>>;
+};
+using list_vadvect_batch_params = typename vadvect_batch_params<
+    make_index_sequence<vadvect_batch_size>>::type;
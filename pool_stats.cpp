@@ -0,0 +1,83 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#include "pool_stats.hpp"
+
+void pool_stats::write_json(std::ostream &os) const {
+  os << "{\n  \"current_bytes\": " << m_current_bytes
+     << ",\n  \"peak_bytes\": " << m_peak_bytes
+     << ",\n  \"counts_get_st\": " << (m_counts_get_st ? "true" : "false")
+     << ",\n  \"contexts\": [";
+  for (std::size_t i = 0; i < m_contexts.size(); ++i) {
+    context_stats const &c = m_contexts[i];
+    os << (i ? "," : "") << "\n    {\"name\": \"" << c.m_name
+       << "\", \"bytes\": " << c.m_bytes
+       << ", \"constant_bytes\": " << c.m_constant_bytes
+       << ", \"tile_bytes\": " << c.m_tile_bytes
+       << ", \"current_bytes\": " << c.m_current_bytes
+       << ", \"peak_bytes\": " << c.m_peak_bytes
+       << ", \"activations\": " << c.m_activations
+       << ", \"active_seconds\": " << c.m_active_seconds << "}";
+  }
+  os << "\n  ],\n  \"fields\": [";
+  for (std::size_t i = 0; i < m_fields.size(); ++i) {
+    field_stats const &f = m_fields[i];
+    os << (i ? "," : "") << "\n    {\"context\": \""
+       << m_contexts[f.m_context].m_name << "\", \"param\": \"" << f.m_name
+       << "\", \"kind\": " << f.m_kind << ", \"level\": " << f.m_level
+       << ", \"shape\": [" << f.m_shape[0]
+       << ", " << f.m_shape[1] << ", " << f.m_shape[2]
+       << "], \"element_size\": " << f.m_element_size
+       << ", \"bytes\": " << f.m_bytes
+       << ", \"current_bytes\": " << f.m_current_bytes
+       << ", \"peak_bytes\": " << f.m_peak_bytes
+       << ", \"get_st\": " << f.m_get_st << ", \"binds\": " << f.m_binds
+       << ", \"rebinds\": " << f.m_rebinds << "}";
+  }
+  os << "\n  ],\n  \"placeholders\": [";
+  for (std::size_t i = 0; i < m_placeholders.size(); ++i) {
+    placeholder_stats const &p = m_placeholders[i];
+    os << (i ? "," : "") << "\n    {\"index\": " << p.m_index
+       << ", \"binds\": " << p.m_binds << ", \"rebinds\": " << p.m_rebinds
+       << "}";
+  }
+  os << "\n  ],\n  \"scratch\": {\"acquires\": " << m_scratch.m_acquires
+     << ", \"heap_allocations\": " << m_scratch.m_heap_allocations
+     << ", \"store_allocations\": " << m_scratch.m_store_allocations
+     << ", \"bytes\": " << m_scratch.m_bytes
+     << ", \"bytes_in_use\": " << m_scratch.m_bytes_in_use
+     << ", \"peak_bytes_in_use\": " << m_scratch.m_peak_bytes_in_use
+     << "}\n}\n";
+}
@@ -0,0 +1,148 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// memory and usage of a context
+struct context_stats {
+  std::string m_name;
+  // bytes of the fields of the repository of the context, and of its
+  // constant fields, that may be shared with other instances. They are 0 if
+  // the domain is split
+  std::size_t m_bytes;
+  std::size_t m_constant_bytes;
+  // bytes of the fields of the repositories of the tiles of the context,
+  // that own the memory of a split domain
+  std::size_t m_tile_bytes;
+  // bytes held while the context is active, now and at the peak
+  std::size_t m_current_bytes;
+  std::size_t m_peak_bytes;
+  // number of times the context was activated (from non active) and total
+  // time it was active, including the current activation
+  unsigned long m_activations;
+  double m_active_seconds;
+};
+
+// memory and usage of a field of a repository
+struct field_stats {
+  unsigned int m_context;
+  long m_param;
+  char const *m_name;
+  // storage kind and time level of the field in the repo info of the
+  // context, with the shape and element size of its data store
+  unsigned int m_kind;
+  unsigned int m_level;
+  unsigned int m_shape[3];
+  unsigned int m_element_size;
+  std::size_t m_bytes;
+  std::size_t m_current_bytes;
+  std::size_t m_peak_bytes;
+  // calls to field_pool::get_st, only counted if FIELD_POOL_STATS is set
+  unsigned long m_get_st;
+  // calls to field_pool::bind_arg for the placeholder of the field, and
+  // number of them that bound it to a different storage
+  unsigned long m_binds;
+  unsigned long m_rebinds;
+};
+
+// temporaries of the scratch pool of the field pool
+struct scratch_stats {
+  unsigned long m_acquires;
+  // acquires that allocated a new block, i.e. that missed the free lists,
+  // and the ones that constructed a new data store on their block
+  unsigned long m_heap_allocations;
+  unsigned long m_store_allocations;
+  // bytes of the blocks owned by the pool, and of those in use now and at
+  // the peak
+  std::size_t m_bytes;
+  std::size_t m_bytes_in_use;
+  std::size_t m_peak_bytes_in_use;
+};
+
+// bind_arg calls of a placeholder of the field pool
+struct placeholder_stats {
+  unsigned int m_index;
+  unsigned long m_binds;
+  unsigned long m_rebinds;
+};
+
+/**
+ * Snapshot of the memory accounting of a field pool: bytes held by the
+ * repositories of the active contexts (now and at the peak), and usage of
+ * each context, field and placeholder
+ */
+struct pool_stats {
+  std::size_t m_current_bytes;
+  std::size_t m_peak_bytes;
+  bool m_counts_get_st;
+  std::vector<context_stats> m_contexts;
+  std::vector<field_stats> m_fields;
+  std::vector<placeholder_stats> m_placeholders;
+  scratch_stats m_scratch;
+
+  void write_json(std::ostream &os) const;
+};
+
+// accumulates the active time of a context
+class context_timer {
+public:
+  context_timer() : m_seconds(0), m_active(false) {}
+
+  void start() {
+    m_start = std::chrono::steady_clock::now();
+    m_active = true;
+  }
+  void stop() {
+    m_seconds += elapsed();
+    m_active = false;
+  }
+  double seconds() const { return m_seconds + (m_active ? elapsed() : 0.); }
+
+private:
+  double elapsed() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         m_start)
+        .count();
+  }
+
+  std::chrono::steady_clock::time_point m_start;
+  double m_seconds;
+  bool m_active;
+};
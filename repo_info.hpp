@@ -0,0 +1,175 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+#pragma once
+#include <tuple>
+#include <type_traits>
+#include "helper.hpp"
+
+/**
+ * List of fields of a context (values of its enum class EnumT) that are
+ * stored in storages of type DataStore. Positions of the fields are
+ * computed with constexpr lookups on a table of the enum values.
+ */
+template <typename DataStore, typename EnumT, EnumT... Params> struct fields {
+  using data_store_t = DataStore;
+  using enum_t = EnumT;
+  static constexpr unsigned int size = sizeof...(Params);
+  // number of time levels of each field
+  static constexpr unsigned int levels = 1;
+  // whether the fields are constant (see constant_fields)
+  static constexpr bool constant = false;
+
+  // values of the fields, the extra element allows empty lists
+  static constexpr long values[sizeof...(Params) + 1] = {(long)Params..., 0};
+
+  // position of the field in the list, -1 if it is not in the list
+  static constexpr int position(EnumT param) {
+    return find_value(values, (long)param, 0, size);
+  }
+
+  static constexpr bool contains(EnumT param) { return position(param) >= 0; }
+};
+
+template <typename DataStore, typename EnumT, EnumT... Params>
+constexpr long fields<DataStore, EnumT, Params...>::values[];
+
+/**
+ * List of fields with several time levels (i.e. the prognostic fields), that
+ * are all stored in the repository. Level 0 is the current time level (now),
+ * level 1 the next one (new) and level 2, if any, the previous one (old).
+ * Rotating the time levels makes each level the previous one of the list
+ * (new becomes now), by swapping the storages instead of copying them.
+ */
+template <unsigned int Levels, typename Fields>
+struct time_levels : Fields {
+  static_assert(Levels > 0, "A field has at least one time level");
+  static constexpr unsigned int levels = Levels;
+};
+
+/**
+ * List of fields that are constant during the run (i.e. masks and metric
+ * terms), that are initialized once. They are stored once, and shared by
+ * the instances of the field pool of an ensemble (see
+ * field_pool::share_constants), and keep their values when their context is
+ * deactivated
+ */
+template <typename Fields> struct constant_fields : Fields {
+  static_assert(Fields::levels == 1,
+                "Constant fields do not have several time levels");
+  static constexpr bool constant = true;
+};
+
+/**
+ * Description of the fields of a context: one fields<> (or time_levels<>,
+ * constant_fields<>) list per storage type
+ */
+template <typename... Fields> struct repo_info {
+  using fields_list_t = type_list<Fields...>;
+};
+
+enum class import_mode { in, in_out };
+
+/**
+ * Field of a context EnumT that holds a copy of the field SrcParam of an
+ * enclosing context SrcEnumT, e.g. to use it in the layout of the context.
+ * It is copied (and transposed if the layouts differ) when the context is
+ * activated, and copied back when it is deactivated unless the mode is
+ * import_mode::in
+ */
+template <typename SrcEnumT, SrcEnumT SrcParam, typename EnumT, EnumT Param,
+          import_mode Mode = import_mode::in_out>
+struct imported_field {
+  using source_enum_t = SrcEnumT;
+  using enum_t = EnumT;
+  static constexpr SrcEnumT source_param = SrcParam;
+  static constexpr EnumT param = Param;
+  static constexpr import_mode mode = Mode;
+};
+
+// imported fields of the context EnumT, a type_list of imported_field
+template <typename EnumT> struct context_imports {
+  using type = type_list<>;
+};
+
+// whether the context Inner is nested in the context Outer, i.e. whether it
+// imports fields from it, directly or through another context. A nested
+// context can only be active while the context it is nested in is active
+template <typename Inner, typename Outer,
+          typename Imports = typename context_imports<Inner>::type>
+struct nested_context;
+
+template <typename Inner, typename Outer, typename... Imports>
+struct nested_context<Inner, Outer, type_list<Imports...>> {
+  static constexpr bool value =
+      first_true(0, std::is_same<typename Imports::source_enum_t,
+                                 Outer>::value...,
+                 nested_context<typename Imports::source_enum_t,
+                                Outer>::value...) >= 0;
+};
+
+/**
+ * Storage infos of the shapes of the fields, one per storage info type. They
+ * are shared by all the data stores with that storage info, whatever their
+ * value type
+ */
+template <typename... StorageInfos> struct storage_info_set {
+  storage_info_set(StorageInfos const &... sinfos) : m_sinfos(sinfos...) {}
+
+  template <typename StorageInfo> StorageInfo const &get() const {
+    return std::get<index_of<StorageInfo, type_list<StorageInfos...>>::value>(
+        m_sinfos);
+  }
+
+private:
+  std::tuple<StorageInfos...> m_sinfos;
+};
+
+// fields of the repo_info stored in DataStore (an empty list if none)
+template <typename RepoInfo, typename DataStore, typename EnumT>
+struct fields_of;
+
+template <typename DataStore, typename EnumT>
+struct fields_of<repo_info<>, DataStore, EnumT> {
+  using type = fields<DataStore, EnumT>;
+};
+
+template <typename F, typename... Fs, typename DataStore, typename EnumT>
+struct fields_of<repo_info<F, Fs...>, DataStore, EnumT> {
+  using type = typename std::conditional<
+      std::is_same<typename F::data_store_t, DataStore>::value, F,
+      typename fields_of<repo_info<Fs...>, DataStore, EnumT>::type>::type;
+};
@@ -34,131 +34,432 @@
   For information: http://eth-cscs.github.io/gridtools/
 */
 
+#pragma once
+#include <algorithm>
+#include <array>
 #include <stencil-composition/stencil-composition.hpp>
 #include "storage-facility.hpp"
 #include "param_definitions.hpp"
+#include "arena.hpp"
+#include "checkpoint.hpp"
 
-template <typename T, typename Elem> struct concat;
+template <typename EnumT, typename repo_info> struct repository {
 
-template <template <class...> class Cont, typename Elem, typename... Vals>
-struct concat<Cont<Vals...>, Elem> {
-  using type = Cont<Vals..., Elem>;
-};
+  using enum_t = EnumT;
+  using fields_list_t = typename repo_info::fields_list_t;
 
-template <int N, template <class...> class Cont, typename Elem, typename R>
-struct repeat {
-  using type =
-      typename repeat<N - 1, Cont, Elem, typename concat<R, Elem>::type>::type;
-};
+  // each fields list of the repo info is a storage kind, whose fields are
+  // all stored in the same data store type, and therefore in an array (with
+  // all the fields of level 0 first, then the ones of level 1, etc.). There
+  // are only a few kinds, unlike fields
+  template <typename List> struct kinds;
+  template <typename... Fields> struct kinds<type_list<Fields...>> {
+    using storages_t =
+        std::tuple<std::array<typename Fields::data_store_t,
+                              Fields::size * Fields::levels>...>;
 
-template <template <class...> class Cont, typename Elem, typename... V>
-struct repeat<0, Cont, Elem, Cont<V...>> {
-  using type = Cont<V...>;
-};
+    // position of the first storage of a kind among all the storages
+    static constexpr unsigned int offset(unsigned int kind) {
+      return sum_first(kind, Fields::size * Fields::levels...);
+    }
 
-template <typename Tuple, int N, typename DataStore> struct create_tuple {
-  template <typename Arg1, typename... Arg>
-  static constexpr Tuple apply(Arg1 arg1, Arg... args) {
-    return create_tuple<Tuple, N - 1, DataStore>::apply(arg1, args..., arg1);
-  }
-};
+    // fields that appear in several lists are stored in the first one
+    static constexpr int kind_of(EnumT param) {
+      return first_true(0, Fields::contains(param)...);
+    }
+  };
+  using kinds_t = kinds<fields_list_t>;
 
-template <typename Tuple, typename DataStore>
-struct create_tuple<Tuple, 1, DataStore> {
-  template <typename Arg1, typename... Arg>
-  static constexpr Tuple apply(Arg1 arg1, Arg... args) {
-    return std::make_tuple(DataStore(arg1), DataStore(args)...);
-  }
-};
+  static constexpr unsigned int num_kinds = fields_list_t::size;
+  // number of storages, i.e. each time level of a field is counted
+  static constexpr unsigned int num_fields = kinds_t::offset(num_kinds);
 
-template <typename Tuple, typename DataStore>
-struct create_tuple<Tuple, 0, DataStore> {
-  template <typename... Arg> static constexpr std::tuple<> apply(Arg... args) {
-    return std::make_tuple();
+  template <unsigned int kind>
+  using kind_fields_t = typename type_at<kind, fields_list_t>::type;
+  template <unsigned int kind>
+  using kind_storage_t = typename kind_fields_t<kind>::data_store_t;
+  template <unsigned int kind>
+  using kind_storage_info_t = typename kind_storage_t<kind>::storage_info_t;
+
+  // storage kind of a field. Unknown fields are mapped to the first kind,
+  // so that the static assert of param_storage reports the error. The kind
+  // is looked up once, since each lookup scans the values of all the lists
+  static constexpr unsigned int first_kind(int kind) {
+    return kind >= 0 ? kind : 0;
   }
-};
 
-template <typename EnumT, typename repo_info> struct repository {
+  template <EnumT param>
+  struct param_kind
+      : std::integral_constant<unsigned int,
+                               first_kind(kinds_t::kind_of(param))> {};
+
+  // position of the field in the list of its kind, held by a class so that
+  // the lookup is done once per field
+  template <EnumT param>
+  struct param_position
+      : std::integral_constant<
+            unsigned int,
+            kind_fields_t<param_kind<param>::value>::position(param)> {};
 
-  using fields_3d_t = typename boost::mpl::at<repo_info, data_store_3d_t>::type;
-  using fields_2d_t = typename boost::mpl::at<repo_info, data_store_2d_t>::type;
+  // position of a time level of the field among all the storages of the
+  // repository, the kinds in the order of the repo info (as in
+  // checkpoint_entries)
+  template <EnumT param, unsigned int level = 0>
+  struct field_index
+      : std::integral_constant<
+            unsigned int,
+            kinds_t::offset(param_kind<param>::value) +
+                level * kind_fields_t<param_kind<param>::value>::size +
+                param_position<param>::value> {};
 
-  static constexpr unsigned int fields_3d_size =
-      boost::mpl::size<fields_3d_t>::value;
-  static constexpr unsigned int fields_2d_size =
-      boost::mpl::size<fields_2d_t>::value;
+  template <EnumT param> struct param_storage {
+    GRIDTOOLS_STATIC_ASSERT((kinds_t::kind_of(param) >= 0),
+                            "The field is not in the repository");
+    using type = kind_storage_t<param_kind<param>::value>;
+  };
 
-  using field_3d_tuple_t = typename repeat<fields_3d_size, std::tuple,
-                                           data_store_3d_t, std::tuple<>>::type;
+  // replaces the data stores of a kind with fresh (non allocated) data
+  // stores associated to the storage info of the kind. Memory is returned
+  // once no other handle to the storage is alive
+  struct reset_kind {
+    repository &m_repo;
+    reset_kind(repository &repo) : m_repo(repo) {}
+    template <typename Kind> void operator()(Kind const &) {
+      for (auto &ds : std::get<Kind::value>(m_repo.m_fields))
+        ds = kind_storage_t<Kind::value>(
+            m_repo.template storage_info<Kind::value>());
+    }
+  };
 
-  using field_2d_tuple_t = typename repeat<fields_2d_size, std::tuple,
-                                           data_store_2d_t, std::tuple<>>::type;
+  struct rotate_kind {
+    repository &m_repo;
+    rotate_kind(repository &repo) : m_repo(repo) {}
+    template <typename Kind> void operator()(Kind const &) {
+      m_repo.m_now[Kind::value] =
+          (m_repo.m_now[Kind::value] + 1) % kind_fields_t<Kind::value>::levels;
+    }
+  };
+
+  // the constant fields are always placed in their arena
+  struct allocate_kind {
+    repository &m_repo;
+    allocate_kind(repository &repo) : m_repo(repo) {}
+    template <typename Kind> void operator()(Kind const &) {
+      if (kind_fields_t<Kind::value>::constant)
+        return;
+      for (auto &ds : std::get<Kind::value>(m_repo.m_fields))
+        ds.allocate();
+    }
+  };
 
-  template <typename Tuple> struct allocate_data_stores {
-    Tuple &m_tuple;
-    allocate_data_stores(Tuple &tuple) : m_tuple(tuple) {}
-    template <typename Index> void operator()(Index const &) {
-      std::get<Index::value>(m_tuple).allocate();
+  struct collect_kind_storages {
+    repository const &m_repo;
+    std::vector<void const *> &m_storages;
+    collect_kind_storages(repository const &repo,
+                          std::vector<void const *> &storages)
+        : m_repo(repo), m_storages(storages) {}
+    template <typename Kind> void operator()(Kind const &) {
+      for (auto const &ds : std::get<Kind::value>(m_repo.m_fields))
+        if (ds.get_storage_ptr())
+          m_storages.push_back(ds.get_storage_ptr().get());
     }
   };
 
-  repository()
-      : m_sinfo_3d(10, 10, 10), m_sinfo_2d(10, 10),
-        m_fields_3d(create_tuple<field_3d_tuple_t, fields_3d_size,
-                                 data_store_3d_t>::apply(m_sinfo_3d)),
-        m_fields_2d(create_tuple<field_2d_tuple_t, fields_2d_size,
-                                 data_store_2d_t>::apply(m_sinfo_2d)) {
-    boost::mpl::for_each<
-        boost::mpl::range_c<int, 0, std::tuple_size<field_3d_tuple_t>::value>>(
-        allocate_data_stores<field_3d_tuple_t>(m_fields_3d));
-    boost::mpl::for_each<
-        boost::mpl::range_c<int, 0, std::tuple_size<field_2d_tuple_t>::value>>(
-        allocate_data_stores<field_2d_tuple_t>(m_fields_2d));
+  // the data stores are only associated to their storage info at
+  // construction, memory is not allocated until the context of the
+  // repository is activated (see allocate()).
+  // The storage infos are owned by the field_pool and shared by all the
+  // fields of the same shape of all the repositories
+  repository(storage_infos_t const &sinfos,
+             allocation_mode mode = allocation_mode::per_field)
+      : m_mode(mode), m_sinfos(sinfos), m_now(), m_allocated(false) {
+    for_each_index<num_kinds>(reset_kind(*this));
   }
 
-  template <EnumT param> struct param_storage {
-    using type = typename std::conditional<
-        !boost::is_same<
-            typename boost::mpl::find<
-                fields_3d_t, boost::mpl::integral_c<EnumT, param>>::type,
-            typename boost::mpl::end<fields_3d_t>::type>::value,
-        data_store_3d_t, data_store_2d_t>::type;
+  bool is_allocated() const { return m_allocated; }
+
+  allocation_mode get_allocation_mode() const { return m_mode; }
+
+  template <unsigned int kind>
+  kind_storage_info_t<kind> const &storage_info() const {
+    return m_sinfos.template get<kind_storage_info_t<kind>>();
+  }
+
+  // number of bytes required to place all the (non constant) fields in an
+  // arena
+  std::size_t footprint() const { return arena_layout(*this).m_total; }
+
+  // number of bytes of the arena of the constant fields
+  std::size_t constant_footprint() const {
+    return arena_layout(*this).m_constant_total;
+  }
+
+  // number of bytes of a field
+  template <EnumT param> std::size_t field_bytes() const {
+    return storage_info<param_kind<param>::value>().size() *
+           sizeof(typename param_storage<param>::type::data_t);
+  }
+
+  // allocates the storages of the repository. If a (shared) arena is passed,
+  // the fields are placed at the beginning of it, and the arena is assumed
+  // to be already initialized, otherwise memory is allocated according to
+  // the allocation mode. The constant fields are placed in their own arena,
+  // whatever the mode
+  void allocate(std::shared_ptr<arena> shared = std::shared_ptr<arena>()) {
+    if (m_allocated)
+      return;
+    allocate_constants();
+    if (shared) {
+      if (shared->size() < footprint())
+        throw(std::runtime_error("Arena too small for the repository"));
+      place_in_arena(shared, false);
+      return;
+    }
+    if (m_mode != allocation_mode::per_field) {
+      place_in_arena(std::make_shared<arena>(
+                         footprint(),
+                         m_mode == allocation_mode::arena_huge_pages),
+                     true);
+      return;
+    }
+    for_each_index<num_kinds>(allocate_kind(*this));
+    place_in_arena(std::shared_ptr<arena>(), false);
+  }
+
+  // the constant fields keep their memory (and values) until the repository,
+  // and the ones it shares them with, are destroyed
+  void release() {
+    if (!m_allocated)
+      return;
+    for_each_index<num_kinds>(reset_kind(*this));
+    m_now.fill(0);
+    // the data stores placed in an arena do not own their memory, therefore
+    // handles to them must not outlive the context of the repository
+    m_arena.reset();
+    m_allocated = false;
+  }
+
+  // entries of the fields of the repository in a checkpoint, stored with
+  // the layout of its arena from offset on. If data is set, the pointers to
+  // the memory of the (allocated) fields are appended to it
+  void checkpoint_entries(unsigned int context, std::size_t offset,
+                          std::vector<checkpoint_entry> &entries,
+                          std::vector<char const *> *data = NULL) const {
+    checkpoint_entry entry = checkpoint_entry();
+    entry.m_context = context;
+    for_each_index<num_kinds>(collect_entries(*this, arena_layout(*this),
+                                              entry, offset, entries, data));
+  }
+
+  // replaces the storages of the repository by the fields placed in the
+  // arena (i.e. the region of a checkpoint), that is already initialized
+  void restore(std::shared_ptr<arena> ar) {
+    if (ar->size() < footprint())
+      throw(std::runtime_error("Arena too small for the repository"));
+    release();
+    place_in_arena(ar, false);
+  }
+
+  // reads the constant fields of an allocated repository from the region of
+  // a checkpoint that starts at offset. Read only constant fields are
+  // already initialized, and possibly shared, therefore they are kept
+  void restore_constants(checkpoint_file const &file, std::size_t offset) {
+    if (m_constants && !m_constants->read_only())
+      file.read(*m_constants, offset, constant_footprint());
+  }
+
+  // makes the repository use the constant fields of source, e.g. the same
+  // repository of another field pool instance, with the same grid
+  void share_constants(repository &source) {
+    if (m_allocated)
+      throw(std::runtime_error(
+          "Can not share the constant fields of an allocated repository"));
+    if (source.constant_footprint() != constant_footprint())
+      throw(std::runtime_error(
+          "The constant fields of the repositories do not match"));
+    source.allocate_constants();
+    m_constants = source.m_constants;
+  }
+
+  // makes the constant fields read only (writes to them fault), or writable
+  // again, for all the repositories that share them
+  void protect_constants(bool read_only) {
+    allocate_constants();
+    if (m_constants)
+      m_constants->protect(read_only);
+  }
+
+  bool shares_constants_with(repository const &other) const {
+    return m_constants && m_constants == other.m_constants;
+  }
+
+  // appends the storages of all the fields (and time levels) of the
+  // repository, e.g. to find the placeholders bound to them
+  void collect_storages(std::vector<void const *> &storages) const {
+    for_each_index<num_kinds>(collect_kind_storages(*this, storages));
+  }
+
+  // makes each time level of the fields the previous one (level 1 becomes
+  // level 0, and level 0 the last level), without moving the storages
+  void rotate_time_levels() { for_each_index<num_kinds>(rotate_kind(*this)); }
+
+  template <EnumT param, unsigned int level = 0>
+  typename param_storage<param>::type &get_st() {
+    constexpr unsigned int kind = param_kind<param>::value;
+    constexpr unsigned int levels = kind_fields_t<kind>::levels;
+    GRIDTOOLS_STATIC_ASSERT((level < levels), "Invalid time level");
+    constexpr unsigned int pos = param_position<param>::value;
+    if (levels == 1)
+      return std::get<kind>(m_fields)[pos];
+    return std::get<kind>(
+        m_fields)[((m_now[kind] + level) % levels) * kind_fields_t<kind>::size +
+                  pos];
+  }
+
+private:
+  // layout of the fields in an arena: the fields of each kind in the order
+  // of the repo info, each of them aligned to arena::field_alignment. The
+  // constant kinds are laid out in the same way in the arena of the constant
+  // fields
+  struct arena_layout {
+    std::array<std::size_t, num_kinds> m_bytes, m_stride, m_offset;
+    std::size_t m_total, m_constant_total;
+
+    struct compute_kind {
+      repository const &m_repo;
+      arena_layout &m_layout;
+      compute_kind(repository const &repo, arena_layout &layout)
+          : m_repo(repo), m_layout(layout) {}
+      template <typename Kind> void operator()(Kind const &) {
+        const std::size_t bytes =
+            m_repo.template storage_info<Kind::value>().size() *
+            sizeof(typename kind_storage_t<Kind::value>::data_t);
+        m_layout.m_bytes[Kind::value] = bytes;
+        m_layout.m_stride[Kind::value] =
+            arena::align_up(bytes, arena::field_alignment);
+        std::size_t &total = kind_fields_t<Kind::value>::constant
+                                 ? m_layout.m_constant_total
+                                 : m_layout.m_total;
+        m_layout.m_offset[Kind::value] = total;
+        total += kind_fields_t<Kind::value>::size *
+                 kind_fields_t<Kind::value>::levels *
+                 m_layout.m_stride[Kind::value];
+      }
+    };
+
+    arena_layout(repository const &repo) : m_total(0), m_constant_total(0) {
+      for_each_index<num_kinds>(compute_kind(repo, *this));
+    }
   };
 
-  template <EnumT param> struct is_3d_storage {
-    using type = typename boost::mpl::not_<typename boost::is_same<
-        typename boost::mpl::find<fields_3d_t,
-                                  boost::mpl::integral_c<EnumT, param>>::type,
-        typename boost::mpl::end<fields_3d_t>::type>::type>::type;
+  // constructs each data store of a kind on top of its slot of the arena
+  // (or of the arena of the constant fields). If touch is set, the memory of
+  // each field is first touched in parallel. The kinds without arena are
+  // allocated per field
+  struct place_kind {
+    repository &m_repo;
+    arena_layout const &m_layout;
+    bool m_touch;
+    place_kind(repository &repo, arena_layout const &layout, bool touch)
+        : m_repo(repo), m_layout(layout), m_touch(touch) {}
+    template <typename Kind> void operator()(Kind const &) {
+      using storage_t = kind_storage_t<Kind::value>;
+      // the constant fields are touched when their arena is created
+      const bool constant = kind_fields_t<Kind::value>::constant;
+      arena *ar = constant ? m_repo.m_constants.get() : m_repo.m_arena.get();
+      if (!ar)
+        return;
+      auto &storages = std::get<Kind::value>(m_repo.m_fields);
+      for (std::size_t i = 0; i < storages.size(); ++i) {
+        const std::size_t offset =
+            m_layout.m_offset[Kind::value] + i * m_layout.m_stride[Kind::value];
+        if (m_touch && !constant)
+          ar->first_touch(offset, m_layout.m_bytes[Kind::value]);
+        storages[i] =
+            storage_t(m_repo.template storage_info<Kind::value>(),
+                      reinterpret_cast<typename storage_t::data_t *>(
+                          ar->data() + offset));
+      }
+    }
   };
 
-  template <EnumT param> struct is_2d_storage {
-    using type = typename boost::mpl::not_<typename boost::is_same<
-        typename boost::mpl::find<fields_2d_t,
-                                  boost::mpl::integral_c<EnumT, param>>::type,
-        typename boost::mpl::end<fields_2d_t>::type>::type>::type;
+  // appends one checkpoint entry per field and time level of a kind, stored
+  // at its offset in the arena layout from offset on, the constant fields
+  // after all the other ones. The levels are stored
+  // in their order, not in the one of their (rotated) storages, so that they
+  // are restored without rotation. If data is set, the pointers to the
+  // memory of the fields are appended to it
+  struct collect_entries {
+    repository const &m_repo;
+    arena_layout const &m_layout;
+    checkpoint_entry m_entry;
+    std::size_t m_offset;
+    std::vector<checkpoint_entry> &m_entries;
+    std::vector<char const *> *m_data;
+    collect_entries(repository const &repo, arena_layout const &layout,
+                    checkpoint_entry const &entry, std::size_t offset,
+                    std::vector<checkpoint_entry> &entries,
+                    std::vector<char const *> *data)
+        : m_repo(repo), m_layout(layout), m_entry(entry), m_offset(offset),
+          m_entries(entries), m_data(data) {}
+    template <typename Kind> void operator()(Kind const &) {
+      using fields_t = kind_fields_t<Kind::value>;
+      const std::array<unsigned int, 3> shape =
+          storage_shape(m_repo.template storage_info<Kind::value>());
+      m_entry.m_kind = Kind::value;
+      std::copy(shape.begin(), shape.end(), m_entry.m_shape);
+      m_entry.m_element_size =
+          sizeof(typename kind_storage_t<Kind::value>::data_t);
+      m_entry.m_bytes = m_layout.m_bytes[Kind::value];
+      auto const &storages = std::get<Kind::value>(m_repo.m_fields);
+      const unsigned int now = m_repo.m_now[Kind::value];
+      const std::size_t region = fields_t::constant ? m_layout.m_total : 0;
+      for (unsigned int level = 0; level < fields_t::levels; ++level)
+        for (unsigned int i = 0; i < fields_t::size; ++i) {
+          const unsigned int slot = level * fields_t::size + i;
+          const unsigned int storage =
+              ((now + level) % fields_t::levels) * fields_t::size + i;
+          m_entry.m_param = fields_t::values[i];
+          m_entry.m_level = level;
+          m_entry.m_offset = m_offset + region +
+                             m_layout.m_offset[Kind::value] +
+                             slot * m_layout.m_stride[Kind::value];
+          m_entries.push_back(m_entry);
+          if (m_data)
+            m_data->push_back(reinterpret_cast<char const *>(
+                storages[storage].get_storage_ptr()->get_cpu_ptr()));
+        }
+    }
   };
 
-  template <EnumT param>
-  typename param_storage<param>::type get_st(
-      typename std::enable_if<is_3d_storage<param>::type::value>::type * = 0) {
-    constexpr unsigned int pos = boost::mpl::find<
-        fields_3d_t, boost::mpl::integral_c<EnumT, param>>::type::pos::value;
-    return std::get<pos>(m_fields_3d);
+  // the arena of the constant fields is created (and first touched) at the
+  // first allocation, and kept for the lifetime of the repository
+  void allocate_constants() {
+    const std::size_t bytes = constant_footprint();
+    if (m_constants || !bytes)
+      return;
+    m_constants = std::make_shared<arena>(
+        bytes, m_mode == allocation_mode::arena_huge_pages);
+    m_constants->first_touch(0, m_constants->size());
   }
 
-  template <EnumT param>
-  typename param_storage<param>::type get_st(
-      typename std::enable_if<is_2d_storage<param>::type::value>::type * = 0) {
-    constexpr unsigned int pos = boost::mpl::find<
-        fields_2d_t, boost::mpl::integral_c<EnumT, param>>::type::pos::value;
-    return std::get<pos>(m_fields_2d);
+  // places all the fields of the repository in the arena (the constant ones
+  // in their arena). If touch is set, the memory of each field is first
+  // touched in parallel. Without arena, only the constant fields are placed
+  void place_in_arena(std::shared_ptr<arena> ar, bool touch) {
+    m_arena = ar;
+    for_each_index<num_kinds>(place_kind(*this, arena_layout(*this), touch));
+    m_allocated = true;
   }
 
-private:
-  storage_info_3d_t m_sinfo_3d;
-  storage_info_2d_t m_sinfo_2d;
+  allocation_mode m_mode;
+  std::shared_ptr<arena> m_arena;
+  // constant fields, shared with the repositories of other instances
+  std::shared_ptr<arena> m_constants;
+  storage_infos_t const &m_sinfos;
+  // storage of the time level 0 of the fields of each kind
+  std::array<unsigned int, num_kinds> m_now;
 
-  field_3d_tuple_t m_fields_3d;
-  field_2d_tuple_t m_fields_2d;
+  typename kinds_t::storages_t m_fields;
+  bool m_allocated;
 };
@@ -0,0 +1,120 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+#include "runtime_repository.hpp"
+#include <algorithm>
+
+void perfect_hash::insert(std::string const &name, field_id id) {
+  if (std::find(m_names.begin(), m_names.end(), name) != m_names.end())
+    throw(std::runtime_error("Field " + name + " is already registered"));
+  m_names.push_back(name);
+  m_ids.push_back(id);
+  try {
+    build();
+  } catch (...) {
+    // the table of the names registered so far is built again
+    m_names.pop_back();
+    m_ids.pop_back();
+    build();
+    throw;
+  }
+}
+
+void perfect_hash::build() {
+  const unsigned int n = m_names.size();
+
+  // the table starts with at least twice as many slots as keys, rounded to a
+  // power of two, and is grown when a bucket finds no displacement
+  unsigned int nslots = 1;
+  while (nslots < 2 * n)
+    nslots *= 2;
+  for (; nslots <= max_slots_per_name * std::max(n, 1u); nslots *= 2)
+    if (place(nslots))
+      return;
+  throw(std::runtime_error("Can not build the hash table of the field names"));
+}
+
+bool perfect_hash::place(unsigned int nslots) {
+  const unsigned int n = m_names.size();
+
+  // there is one bucket every two keys, rounded to a power of two
+  unsigned int nbuckets = 1;
+  while (2 * nbuckets < n)
+    nbuckets *= 2;
+  m_mask = nslots - 1;
+  m_bucket_mask = nbuckets - 1;
+
+  std::vector<std::vector<unsigned int>> buckets(nbuckets);
+  for (unsigned int i = 0; i < n; ++i)
+    buckets[hash(m_names[i], 0) & m_bucket_mask].push_back(i);
+
+  // place the largest buckets first, searching for each bucket a
+  // displacement that maps all its keys to free slots
+  std::vector<unsigned int> order(nbuckets);
+  for (unsigned int b = 0; b < nbuckets; ++b)
+    order[b] = b;
+  std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+
+  m_displacements.assign(nbuckets, 0);
+  m_slots.assign(nslots, -1);
+  std::vector<unsigned int> slots;
+  for (unsigned int b : order) {
+    if (buckets[b].empty())
+      break;
+    unsigned int d = 1;
+    for (; d <= max_displacement; ++d) {
+      slots.clear();
+      for (unsigned int key : buckets[b]) {
+        const unsigned int slot = hash(m_names[key], d) & m_mask;
+        if (m_slots[slot] >= 0 ||
+            std::find(slots.begin(), slots.end(), slot) != slots.end())
+          break;
+        slots.push_back(slot);
+      }
+      if (slots.size() == buckets[b].size()) {
+        m_displacements[b] = d;
+        for (unsigned int k = 0; k < slots.size(); ++k)
+          m_slots[slots[k]] = buckets[b][k];
+        break;
+      }
+    }
+    if (d > max_displacement)
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,236 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+#pragma once
+#include <string>
+#include <tuple>
+#include <vector>
+#include <array>
+#include <stdexcept>
+#include <stencil-composition/stencil-composition.hpp>
+#include "storage-facility.hpp"
+#include "param_definitions.hpp"
+
+/**
+ * Storage types that can be registered in a runtime_repository. The kind is
+ * the position of the storage type in runtime_repository::fields_tuple_t
+ */
+template <typename DataStore> struct runtime_storage_kind;
+
+template <> struct runtime_storage_kind<data_store_3d_t> {
+  static constexpr unsigned int value = 0;
+};
+
+template <> struct runtime_storage_kind<data_store_2d_t> {
+  static constexpr unsigned int value = 1;
+};
+
+/**
+ * Identifier of a field registered in a runtime_repository. It is obtained
+ * once (by name) and then used in the hot path, where accessing the storage
+ * is an indexed load.
+ */
+struct field_id {
+  unsigned int m_kind;
+  unsigned int m_context;
+  unsigned int m_index;
+};
+
+/**
+ * Perfect hash (hash and displace) from the names of the fields to their
+ * field_id. It is not minimal: the table has at least twice as many slots as
+ * names, and is grown if the displacements of a bucket are exhausted. The
+ * table is rebuilt every time a name is inserted, which only happens at
+ * registration time.
+ */
+class perfect_hash {
+public:
+  perfect_hash() : m_mask(0), m_bucket_mask(0) {}
+
+  void insert(std::string const &name, field_id id);
+
+  // returns the field_id of the name, throws if the name is not registered
+  field_id const &find(std::string const &name) const {
+    if (m_slots.empty())
+      throw(std::runtime_error("Unknown field " + name));
+    const unsigned int slot =
+        hash(name, m_displacements[hash(name, 0) & m_bucket_mask]) & m_mask;
+    if (m_slots[slot] < 0 || m_names[m_slots[slot]] != name)
+      throw(std::runtime_error("Unknown field " + name));
+    return m_ids[m_slots[slot]];
+  }
+
+  unsigned int size() const { return m_names.size(); }
+
+  // seeded FNV-1a hash
+  static unsigned int hash(std::string const &name, unsigned int seed) {
+    unsigned int h = 2166136261u ^ (seed * 16777619u);
+    for (char c : name) {
+      h ^= static_cast<unsigned char>(c);
+      h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+  }
+
+private:
+  // seeds tried for each bucket before the table is grown
+  static constexpr unsigned int max_displacement = 1024;
+  // largest number of slots per name, beyond which the build throws
+  static constexpr unsigned int max_slots_per_name = 64;
+
+  void build();
+  // places the names in a table of nslots slots, returns false if a bucket
+  // found no displacement
+  bool place(unsigned int nslots);
+
+  std::vector<std::string> m_names;
+  std::vector<field_id> m_ids;
+  // displacement (seed of the second hash) of each bucket
+  std::vector<unsigned int> m_displacements;
+  // position in m_names of the key stored in each slot (-1 if empty)
+  std::vector<int> m_slots;
+  unsigned int m_mask;
+  unsigned int m_bucket_mask;
+};
+
+/**
+ * Repository of storages registered at runtime and accessed by name, as an
+ * alternative to the compile time repository. Each field belongs to a
+ * context (given by its position in the field_pool context list), and it is
+ * allocated and released together with the storages of that context.
+ */
+class runtime_repository {
+public:
+  using fields_tuple_t = std::tuple<std::vector<data_store_3d_t>,
+                                    std::vector<data_store_2d_t>>;
+  static constexpr unsigned int num_kinds =
+      std::tuple_size<fields_tuple_t>::value;
+
+  runtime_repository(storage_info_3d_t const &sinfo_3d,
+                     storage_info_2d_t const &sinfo_2d)
+      : m_sinfos(sinfo_3d, sinfo_2d) {}
+
+  template <typename DataStore>
+  field_id register_field(std::string const &name, unsigned int context,
+                          bool allocate) {
+    constexpr unsigned int kind = runtime_storage_kind<DataStore>::value;
+    auto &fields = std::get<kind>(m_fields);
+
+    field_id id{kind, context, static_cast<unsigned int>(fields.size())};
+    m_hash.insert(name, id);
+    fields.push_back(DataStore(std::get<kind>(m_sinfos)));
+    if (allocate)
+      fields.back().allocate();
+    m_contexts[kind].push_back(context);
+    return id;
+  }
+
+  field_id const &find(std::string const &name) const {
+    return m_hash.find(name);
+  }
+
+  template <typename DataStore> DataStore &get(field_id const &id) {
+    return std::get<runtime_storage_kind<DataStore>::value>(
+        m_fields)[id.m_index];
+  }
+
+  unsigned int size() const { return m_hash.size(); }
+
+  void allocate(unsigned int context) {
+    allocate_kind<0>(context);
+    allocate_kind<1>(context);
+  }
+
+  void release(unsigned int context) {
+    release_kind<0>(context);
+    release_kind<1>(context);
+  }
+
+  // bytes held by the allocated fields of a context
+  std::size_t footprint(unsigned int context) const {
+    return kind_footprint<0>(context) + kind_footprint<1>(context);
+  }
+
+  // appends the storages of the fields of a context
+  void collect_storages(unsigned int context,
+                        std::vector<void const *> &storages) const {
+    collect_kind<0>(context, storages);
+    collect_kind<1>(context, storages);
+  }
+
+private:
+  template <unsigned int Kind> void allocate_kind(unsigned int context) {
+    auto &fields = std::get<Kind>(m_fields);
+    for (unsigned int i = 0; i < fields.size(); ++i)
+      if (m_contexts[Kind][i] == context)
+        fields[i].allocate();
+  }
+
+  template <unsigned int Kind>
+  void collect_kind(unsigned int context,
+                    std::vector<void const *> &storages) const {
+    auto const &fields = std::get<Kind>(m_fields);
+    for (unsigned int i = 0; i < fields.size(); ++i)
+      if (m_contexts[Kind][i] == context && fields[i].get_storage_ptr())
+        storages.push_back(fields[i].get_storage_ptr().get());
+  }
+
+  template <unsigned int Kind>
+  std::size_t kind_footprint(unsigned int context) const {
+    auto const &fields = std::get<Kind>(m_fields);
+    std::size_t bytes = 0;
+    for (unsigned int i = 0; i < fields.size(); ++i)
+      if (m_contexts[Kind][i] == context && fields[i].get_storage_ptr())
+        bytes +=
+            std::get<Kind>(m_sinfos).size() * sizeof(gridtools::float_type);
+    return bytes;
+  }
+
+  template <unsigned int Kind> void release_kind(unsigned int context) {
+    auto &fields = std::get<Kind>(m_fields);
+    using data_store_t =
+        typename std::tuple_element<Kind, fields_tuple_t>::type::value_type;
+    for (unsigned int i = 0; i < fields.size(); ++i)
+      if (m_contexts[Kind][i] == context)
+        fields[i] = data_store_t(std::get<Kind>(m_sinfos));
+  }
+
+  std::tuple<storage_info_3d_t const &, storage_info_2d_t const &> m_sinfos;
+  fields_tuple_t m_fields;
+  // context of each of the fields, per storage kind
+  std::array<std::vector<unsigned int>, num_kinds> m_contexts;
+  perfect_hash m_hash;
+};
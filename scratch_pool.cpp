@@ -0,0 +1,101 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include "scratch_pool.hpp"
+
+namespace {
+std::size_t class_bytes(unsigned int c) { return arena::field_alignment << c; }
+} // namespace
+
+scratch_pool::scratch_pool() : m_stats() {}
+
+scratch_pool::~scratch_pool() {
+  for (auto &blocks : m_free)
+    for (block &b : blocks) {
+      b.m_store.reset();
+      std::free(b.m_data);
+    }
+}
+
+scratch_pool::block scratch_pool::acquire(std::size_t bytes) {
+  unsigned int c = 0;
+  while (class_bytes(c) < bytes)
+    if (++c == num_classes)
+      throw(std::runtime_error("Scratch field too large"));
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_stats.m_acquires;
+  m_stats.m_bytes_in_use += class_bytes(c);
+  m_stats.m_peak_bytes_in_use =
+      std::max(m_stats.m_peak_bytes_in_use, m_stats.m_bytes_in_use);
+  if (!m_free[c].empty()) {
+    block b = std::move(m_free[c].back());
+    m_free[c].pop_back();
+    return b;
+  }
+
+  void *ptr = NULL;
+  if (posix_memalign(&ptr, arena::field_alignment, class_bytes(c))) {
+    m_stats.m_bytes_in_use -= class_bytes(c);
+    throw std::bad_alloc();
+  }
+  ++m_stats.m_heap_allocations;
+  m_stats.m_bytes += class_bytes(c);
+  // the free list can hold all the blocks of the class, so that releasing
+  // them does not allocate
+  m_free[c].reserve(m_stats.m_heap_allocations);
+  return block{static_cast<char *>(ptr), c, std::shared_ptr<void>(), NULL,
+               {{0, 0, 0}}};
+}
+
+void scratch_pool::release(block const &b) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_free[b.m_class].push_back(b);
+  m_stats.m_bytes_in_use -= class_bytes(b.m_class);
+}
+
+void scratch_pool::count_store_allocation() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_stats.m_store_allocations;
+}
+
+scratch_stats scratch_pool::stats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
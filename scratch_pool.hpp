@@ -0,0 +1,148 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "arena.hpp"
+#include "param_definitions.hpp"
+#include "pool_stats.hpp"
+
+/**
+ * Free lists of the memory of the temporaries of the operators. The blocks
+ * are grouped in size classes (powers of two, from arena::field_alignment
+ * bytes), and a released block is kept in the free list of its class for
+ * the next temporary of that class. Once each class holds as many blocks as
+ * temporaries alive at the same time (i.e. after the first time step),
+ * acquiring a block does not allocate.
+ * Each block also keeps the last data store placed on it, that is reused by
+ * the next temporary of the same type and shape, since constructing a data
+ * store allocates its handles.
+ */
+class scratch_pool {
+public:
+  struct block {
+    char *m_data;
+    unsigned int m_class;
+    // data store on top of the block, of the type identified by m_type and
+    // of shape m_shape, null if none
+    std::shared_ptr<void> m_store;
+    void const *m_type;
+    std::array<unsigned int, 3> m_shape;
+  };
+
+  scratch_pool();
+  ~scratch_pool();
+
+  scratch_pool(scratch_pool const &) = delete;
+  scratch_pool &operator=(scratch_pool const &) = delete;
+
+  // block of at least bytes bytes, aligned to arena::field_alignment. Its
+  // memory is not initialized
+  block acquire(std::size_t bytes);
+  void release(block const &b);
+
+  // counts a data store constructed on top of a block
+  void count_store_allocation();
+
+  scratch_stats stats() const;
+
+private:
+  static constexpr unsigned int num_classes = 40;
+
+  mutable std::mutex m_mutex;
+  std::array<std::vector<block>, num_classes> m_free;
+  scratch_stats m_stats;
+};
+
+/**
+ * Temporary field of an operator, placed in a block of a scratch pool that
+ * is returned to the pool when the handle goes out of scope. Copies of its
+ * data store must therefore not outlive the handle. The data store of the
+ * block is reused if it has the type and the shape of the storage info
+ */
+template <typename DataStore> class scratch_field {
+public:
+  using storage_info_t = typename DataStore::storage_info_t;
+  using data_t = typename DataStore::data_t;
+
+  scratch_field(scratch_pool &pool, storage_info_t const &sinfo)
+      : m_pool(&pool), m_block(pool.acquire(sinfo.size() * sizeof(data_t))) {
+    const std::array<unsigned int, 3> shape = storage_shape(sinfo);
+    if (m_block.m_type != type_tag() || m_block.m_shape != shape) {
+      try {
+        m_block.m_store = std::make_shared<DataStore>(
+            sinfo, reinterpret_cast<data_t *>(m_block.m_data));
+      } catch (...) {
+        pool.release(m_block);
+        throw;
+      }
+      m_block.m_type = type_tag();
+      m_block.m_shape = shape;
+      pool.count_store_allocation();
+    }
+  }
+
+  scratch_field(scratch_field &&other)
+      : m_pool(other.m_pool), m_block(other.m_block) {
+    other.m_pool = NULL;
+  }
+
+  scratch_field(scratch_field const &) = delete;
+  scratch_field &operator=(scratch_field const &) = delete;
+
+  ~scratch_field() {
+    if (m_pool)
+      m_pool->release(m_block);
+  }
+
+  DataStore &get() { return *static_cast<DataStore *>(m_block.m_store.get()); }
+  DataStore const &get() const {
+    return *static_cast<DataStore const *>(m_block.m_store.get());
+  }
+
+private:
+  // address identifying the type DataStore
+  static void const *type_tag() {
+    static const char tag = 0;
+    return &tag;
+  }
+
+  scratch_pool *m_pool;
+  scratch_pool::block m_block;
+};
@@ -0,0 +1,100 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+#include "task_graph.hpp"
+#include <algorithm>
+
+void task_graph::add_edge(unsigned int from, unsigned int to) {
+  if (from == to)
+    return;
+  std::vector<unsigned int> &succ = m_nodes[from]->m_successors;
+  if (std::find(succ.begin(), succ.end(), to) != succ.end())
+    return;
+  succ.push_back(to);
+  ++m_nodes[to]->m_npredecessors;
+}
+
+void task_graph::add(std::function<void()> task,
+                     std::vector<key_t> const &reads,
+                     std::vector<key_t> const &writes) {
+  const unsigned int id = m_nodes.size();
+  m_nodes.push_back(std::unique_ptr<node>(new node()));
+  m_nodes.back()->m_task = std::move(task);
+  m_nodes.back()->m_npredecessors = 0;
+
+  for (key_t key : reads) {
+    access &acc = m_accesses[key];
+    if (acc.m_last_writer >= 0)
+      add_edge(acc.m_last_writer, id);
+    acc.m_readers.push_back(id);
+  }
+  for (key_t key : writes) {
+    access &acc = m_accesses[key];
+    if (acc.m_last_writer >= 0)
+      add_edge(acc.m_last_writer, id);
+    for (unsigned int reader : acc.m_readers)
+      add_edge(reader, id);
+    acc.m_readers.clear();
+    acc.m_last_writer = id;
+  }
+}
+
+void task_graph::schedule(thread_pool &pool, unsigned int task) {
+  pool.submit([this, &pool, task]() {
+    m_nodes[task]->m_task();
+    for (unsigned int succ : m_nodes[task]->m_successors)
+      if (--m_nodes[succ]->m_remaining == 0)
+        schedule(pool, succ);
+  });
+}
+
+void task_graph::run(thread_pool &pool) {
+  for (auto &n : m_nodes)
+    n->m_remaining = n->m_npredecessors;
+  for (unsigned int i = 0; i < m_nodes.size(); ++i)
+    if (!m_nodes[i]->m_npredecessors)
+      schedule(pool, i);
+
+  try {
+    pool.wait();
+  } catch (...) {
+    m_nodes.clear();
+    m_accesses.clear();
+    throw;
+  }
+  m_nodes.clear();
+  m_accesses.clear();
+}
@@ -0,0 +1,158 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "param_definitions.hpp"
+#include "thread_pool.hpp"
+
+// whether T is a data store, i.e. it has a storage shared by its copies
+template <typename T> struct has_storage_ptr {
+  template <typename U>
+  static std::true_type test(decltype(&U::get_storage_ptr));
+  template <typename U> static std::false_type test(...);
+  static constexpr bool value = decltype(test<T>(nullptr))::value;
+};
+
+// key identifying the memory accessed by a task: the storage of the data
+// stores, or the address of any other object (i.e. an operator that holds
+// bound placeholders). Copies of a data store have different addresses,
+// therefore each data store type needs its overload below
+template <typename T> void const *task_key(T const &t) {
+  static_assert(!has_storage_ptr<T>::value,
+                "task_key is not defined for the data store type");
+  return &t;
+}
+
+template <typename T> void const *task_key(data_store_3d<T> const &ds) {
+  return ds.get_storage_ptr().get();
+}
+
+template <typename T> void const *task_key(data_store_2d<T> const &ds) {
+  return ds.get_storage_ptr().get();
+}
+
+template <typename T>
+void const *task_key(data_store_3d_stag<T> const &ds) {
+  return ds.get_storage_ptr().get();
+}
+
+template <typename T> void const *task_key(data_store_1d<T> const &ds) {
+  return ds.get_storage_ptr().get();
+}
+
+template <typename T>
+void const *task_key(data_store_3d_column<T> const &ds) {
+  return ds.get_storage_ptr().get();
+}
+
+inline void const *task_key(data_store_tracer_t const &ds) {
+  return ds.get_storage_ptr().get();
+}
+
+template <unsigned int I, unsigned int N> struct collect_task_keys {
+  template <typename Tuple>
+  static void apply(Tuple const &tuple, std::vector<void const *> &keys) {
+    keys.push_back(task_key(std::get<I>(tuple)));
+    collect_task_keys<I + 1, N>::apply(tuple, keys);
+  }
+};
+
+template <unsigned int N> struct collect_task_keys<N, N> {
+  template <typename Tuple>
+  static void apply(Tuple const &, std::vector<void const *> &) {}
+};
+
+/**
+ * Records operator calls together with the fields they read and write, and
+ * builds a DAG of their dependencies (read after write, write after read and
+ * write after write). Running the graph executes independent operators
+ * concurrently on a thread pool.
+ *
+ * Operators that hold state shared among their calls (i.e. the placeholders
+ * bound in the field_pool) must also pass themselves as an output, so that
+ * their calls are serialized.
+ */
+class task_graph {
+public:
+  typedef void const *key_t;
+
+  void add(std::function<void()> task, std::vector<key_t> const &reads,
+           std::vector<key_t> const &writes);
+
+  // the reads and writes are given as the input(...) and output(...) tuples
+  // of the operators
+  template <typename... In, typename... Out>
+  void add(std::function<void()> task, std::tuple<In...> const &it,
+           std::tuple<Out...> const &ot) {
+    std::vector<key_t> reads, writes;
+    collect_task_keys<0, sizeof...(In)>::apply(it, reads);
+    collect_task_keys<0, sizeof...(Out)>::apply(ot, writes);
+    add(std::move(task), reads, writes);
+  }
+
+  // executes all the recorded tasks and clears the graph
+  void run(thread_pool &pool);
+
+  unsigned int size() const { return m_nodes.size(); }
+
+private:
+  struct node {
+    std::function<void()> m_task;
+    std::vector<unsigned int> m_successors;
+    unsigned int m_npredecessors;
+    std::atomic<unsigned int> m_remaining;
+  };
+
+  // last task writing a key and the tasks reading it since then
+  struct access {
+    int m_last_writer;
+    std::vector<unsigned int> m_readers;
+    access() : m_last_writer(-1) {}
+  };
+
+  void add_edge(unsigned int from, unsigned int to);
+  void schedule(thread_pool &pool, unsigned int task);
+
+  std::vector<std::unique_ptr<node>> m_nodes;
+  std::unordered_map<key_t, access> m_accesses;
+};
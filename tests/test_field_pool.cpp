@@ -0,0 +1,389 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+// Regression tests of the field management layer. Each check throws if the
+// behavior it covers is broken, and the failed checks are reported on
+// stderr.
+//
+// usage: test_field_pool
+
+#include <array>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../field_pool.hpp"
+
+namespace {
+
+void check(bool condition, std::string const &what) {
+  if (!condition)
+    throw(std::runtime_error(what));
+}
+
+// whether f throws a std::runtime_error
+template <typename F> bool throws(F &&f) {
+  try {
+    f();
+  } catch (std::runtime_error const &) {
+    return true;
+  }
+  return false;
+}
+
+// snapshots whose fields throw (e.g. a field out of its context) must give
+// their staging buffer back, otherwise the next snapshots wait forever
+void check_output_exceptions() {
+  output_stage output("test_field_pool_output", 2);
+  output.add_field("u", 8, []() -> char const * {
+    throw(std::runtime_error("Can not access storage out of context"));
+  });
+  for (unsigned int i = 0; i < 4; ++i)
+    check(throws([&]() { output.snapshot(i); }), "The snapshot did not throw");
+  output.flush();
+  check(!output.stalls() && !output.written(), "Failed snapshots were queued");
+}
+
+// a failed write is reported once, and the stage keeps taking snapshots
+void check_output_write_errors() {
+  static const char data[8] = {};
+  output_stage output("test_field_pool_missing_dir/output", 2);
+  output.add_field("u", sizeof(data), []() { return data; });
+  for (unsigned int i = 0; i < 2; ++i) {
+    output.snapshot(i);
+    check(throws([&]() { output.flush(); }), "The failed write was ignored");
+    check(!throws([&]() { output.flush(); }),
+          "The failed write was reported twice");
+  }
+  check(!output.written(), "A failed write was counted");
+}
+
+// temporaries of the same type and shape are all placed in the first
+// block of the scratch pool, with the data store constructed by the first
+// one
+void check_scratch_reuse() {
+  field_pool fpool(grid_descriptor(8, 8, 4, 2));
+  for (unsigned int i = 0; i < 4; ++i) {
+    auto tmp = fpool.get_scratch<data_store_3d_t>();
+    check(tmp.get().valid(), "Invalid scratch field");
+  }
+  const scratch_stats scratch = fpool.stats().m_scratch;
+  check(scratch.m_heap_allocations == 1 && scratch.m_store_allocations == 1,
+        "The scratch fields were not reused");
+}
+
+// a data store is only reused by a storage info of the same shape, also when
+// the storage info is placed at the address of a previous one
+void check_scratch_shape() {
+  field_pool fpool(grid_descriptor(8, 8, 4, 2));
+  const std::array<unsigned int, 3> shapes[] = {{{8, 8, 4}}, {{8, 4, 8}}};
+  for (std::array<unsigned int, 3> const &shape : shapes) {
+    const storage_info_3d_t sinfo(shape[0], shape[1], shape[2]);
+    auto tmp = fpool.get_scratch<data_store_3d_t>(sinfo);
+    check(storage_shape(*tmp.get().get_storage_info_ptr()) == shape,
+          "The scratch field has the shape of another storage info");
+  }
+  const scratch_stats scratch = fpool.stats().m_scratch;
+  check(scratch.m_heap_allocations == 1 && scratch.m_store_allocations == 2,
+        "The data store was reused by a storage info of another shape");
+}
+
+// the contexts of an alias group are never active together, and the arena
+// of the group is only held while one of them is active
+void check_alias_group() {
+  field_pool fpool(grid_descriptor(8, 8, 4, 2));
+  fpool.alias_contexts<fast_waves_sc_param, hdiff_param>();
+  fpool.activate_context<dycore_param>();
+  const std::size_t dycore_bytes = fpool.stats().m_current_bytes;
+  {
+    auto guard = fpool.enter_context<hdiff_param>();
+    check(fpool.stats().m_current_bytes > dycore_bytes,
+          "The arena of the group is not counted");
+    check(throws([&]() { fpool.activate_context<fast_waves_sc_param>(); }),
+          "Two contexts of an alias group were active together");
+  }
+  check(fpool.stats().m_current_bytes == dycore_bytes,
+        "The arena of the group was not released");
+  {
+    auto guard = fpool.enter_context<fast_waves_sc_param>();
+    check(fpool.get_st<fast_waves_sc_param, fast_waves_sc_param::lgsA>(guard)
+              .valid(),
+          "Invalid field of an aliased context");
+  }
+  check(fpool.stats().m_current_bytes == dycore_bytes,
+        "The arena of the group was not released");
+  fpool.deactivate_context<dycore_param>();
+}
+
+// every registered name is found by the hash table, and the names that are
+// not registered are rejected
+void check_runtime_lookup() {
+  perfect_hash hash;
+  const unsigned int n = 500;
+  for (unsigned int i = 0; i < n; ++i)
+    hash.insert("q" + std::to_string(i), field_id{0, 0, i});
+  for (unsigned int i = 0; i < n; ++i)
+    check(hash.find("q" + std::to_string(i)).m_index == i,
+          "Wrong field_id of a registered name");
+  check(throws([&]() { hash.find("qn"); }), "Found an unregistered name");
+  check(throws([&]() { hash.insert("q0", field_id{0, 0, n}); }),
+        "A name was registered twice");
+  check(hash.size() == n, "Wrong number of registered names");
+}
+
+// tracers are only added while their context is not active, even if its
+// bundle is empty
+void check_add_tracer() {
+  field_pool fpool(grid_descriptor(8, 8, 4, 2));
+  fpool.activate_context<dycore_param>();
+  check(throws([&]() { fpool.add_tracer<dycore_param>("qc"); }),
+        "A tracer was added to an active context");
+  fpool.deactivate_context<dycore_param>();
+  fpool.add_tracer<dycore_param>("qc");
+  fpool.activate_context<dycore_param>();
+  check(fpool.get_tracers<dycore_param>().get_tracer("qc").valid(),
+        "Invalid tracer");
+  fpool.deactivate_context<dycore_param>();
+}
+
+// a guard left out of order reports the error instead of throwing from its
+// destructor, and leave() throws it
+void check_guard_order() {
+  field_pool fpool(grid_descriptor(8, 8, 4, 2));
+  auto fw = [&]() {
+    auto dycore = fpool.enter_context<dycore_param>();
+    auto guard = fpool.enter_context<fast_waves_sc_param>(dycore);
+    check(throws([&]() { dycore.leave(); }),
+          "Left a context whose fields are imported");
+    return guard;
+  }();
+  check(fpool.is_active<dycore_param>(),
+        "The imported context was deactivated");
+  fw.leave();
+  check(!fpool.is_active<fast_waves_sc_param>(), "The guard was not left");
+  fpool.deactivate_context<dycore_param>();
+}
+
+// a guard only gives access to the fields of its own pool, and not after it
+// is left
+void check_guard_pool() {
+  field_pool first(grid_descriptor(8, 8, 4, 2));
+  field_pool second(grid_descriptor(8, 8, 4, 2));
+  auto guard = first.enter_context<dycore_param>();
+  second.activate_context<dycore_param>();
+  first.get_st<dycore_param, dycore_param::u>(guard);
+#if FIELD_POOL_CHECK_CONTEXT
+  check(throws([&]() { second.get_st<dycore_param, dycore_param::u>(guard); }),
+        "Accessed a pool with the guard of another pool");
+  guard.leave();
+  check(throws([&]() { first.get_st<dycore_param, dycore_param::u>(guard); }),
+        "Accessed a pool with a guard that was left");
+#endif
+  second.deactivate_context<dycore_param>();
+}
+
+// bindings to the same storage keep the generation of the placeholder, also
+// when they come from several threads, and a binding to another storage
+// changes it
+void check_bind_arg() {
+  field_pool fpool(grid_descriptor(8, 8, 4, 2));
+  fpool.activate_context<dycore_param>();
+  auto const &u = fpool.get_st<dycore_param, dycore_param::u>();
+  auto const &v = fpool.get_st<dycore_param, dycore_param::v>();
+  const unsigned long generation = fpool.bind_arg<vadvect, vadvect::data>(u);
+  check(generation != 0, "The placeholder was not bound");
+
+  std::vector<std::thread> threads;
+  std::vector<unsigned long> generations(4);
+  for (unsigned int t = 0; t < generations.size(); ++t)
+    threads.emplace_back([&, t]() {
+      for (unsigned int i = 0; i < 1000; ++i)
+        generations[t] = fpool.bind_arg<vadvect, vadvect::data>(u);
+    });
+  for (auto &thread : threads)
+    thread.join();
+  for (unsigned long g : generations)
+    check(g == generation, "A binding to the same storage rebound");
+
+  check(fpool.bind_arg<vadvect, vadvect::data>(v) == generation + 1 &&
+            fpool.arg_generation<vadvect, vadvect::data>() == generation + 1,
+        "A binding to another storage did not rebind");
+  fpool.deactivate_context<dycore_param>();
+}
+
+// a restart unbinds the placeholders of the restored contexts and of their
+// importers, sets the imported views up on the restored fields, and rejects
+// a pool split in tiles
+void check_restart() {
+  const std::string path = "test_field_pool_restart.chk";
+  field_pool fpool(grid_descriptor(8, 8, 4, 2));
+  auto dycore = fpool.enter_context<dycore_param>();
+  auto fw = fpool.enter_context<fast_waves_sc_param>(dycore);
+  const unsigned long generation =
+      fpool.bind_arg<fast_waves_sc_param, fast_waves_sc_param::w>(
+          fpool.get_st<fast_waves_sc_param, fast_waves_sc_param::w>(fw));
+  fpool.write_checkpoint(path);
+  fpool.restart(path, restart_mode::read);
+  std::remove(path.c_str());
+
+  check(fpool.arg_generation<fast_waves_sc_param, fast_waves_sc_param::w>() !=
+            generation,
+        "The placeholder of an imported field was not unbound");
+  auto const &w = fpool.get_st<dycore_param, dycore_param::w>(dycore);
+  auto const &fw_w =
+      fpool.get_st<fast_waves_sc_param, fast_waves_sc_param::w>(fw);
+  if (same_layout<storage_info_3d_t, storage_info_3d_column_t>::value)
+    check(fw_w.get_storage_ptr()->get_cpu_ptr() ==
+              w.get_storage_ptr()->get_cpu_ptr(),
+          "The imported view was not set up on the restored field");
+
+  field_pool split(grid_descriptor(8, 8, 4, 2), allocation_mode::per_field,
+                   context_mode::shared, tiling(2, 1));
+  auto guard = split.enter_context<dycore_param>();
+  check(throws([&]() { split.write_checkpoint(path); }),
+        "A pool split in tiles was checkpointed");
+  check(throws([&]() { split.restart(path); }),
+        "A pool split in tiles was restarted");
+}
+
+// the tiles own the memory of the fields of a split domain: the whole
+// domain is not allocated, and its fields are scattered to the tiles and
+// gathered back on demand
+void check_split_domain() {
+  field_pool fpool(grid_descriptor(8, 6, 4, 2), allocation_mode::per_field,
+                   context_mode::shared, tiling(2, 2));
+  auto dycore = fpool.enter_context<dycore_param>();
+  context_stats const stats = fpool.stats().m_contexts[0];
+  check(stats.m_bytes == 0 && stats.m_tile_bytes != 0 &&
+            stats.m_current_bytes == stats.m_tile_bytes,
+        "The whole domain of a split context holds memory");
+#if FIELD_POOL_CHECK_CONTEXT
+  check(throws([&]() { fpool.get_st<dycore_param, dycore_param::u>(); }),
+        "Accessed the whole domain of a split context");
+#endif
+
+  auto input = fpool.get_scratch<data_store_3d_t>();
+  auto *in = input.get().get_storage_ptr()->get_cpu_ptr();
+  const std::size_t size = fpool.storage_info_3d().size();
+  for (std::size_t i = 0; i < size; ++i)
+    in[i] = i;
+  fpool.scatter_to_tiles<dycore_param, dycore_param::u>(input.get());
+  auto output = fpool.gather_from_tiles<dycore_param, dycore_param::u>();
+  auto const *out = output.get().get_storage_ptr()->get_cpu_ptr();
+  for (std::size_t i = 0; i < size; ++i)
+    check(out[i] == in[i], "The tiles were not gathered");
+
+  auto fw = fpool.enter_context<fast_waves_sc_param>(dycore);
+  if (same_layout<storage_info_3d_t, storage_info_3d_column_t>::value)
+    for (unsigned int t = 0; t < fpool.num_tiles(); ++t)
+      check(fpool.get_st<fast_waves_sc_param, fast_waves_sc_param::w>(t)
+                    .get_storage_ptr()
+                    ->get_cpu_ptr() ==
+                fpool.get_st<dycore_param, dycore_param::w>(t)
+                    .get_storage_ptr()
+                    ->get_cpu_ptr(),
+            "The field was not imported in the tiles");
+}
+
+// the tendencies are stored in single precision, and bound to the single
+// precision placeholders of the vertical advection
+void check_float_fields() {
+  field_pool fpool(grid_descriptor(8, 8, 4, 2));
+  auto dycore = fpool.enter_context<dycore_param>();
+  auto &utens = fpool.get_st<dycore_param, dycore_param::utens>(dycore);
+  static_assert(
+      std::is_same<std::decay<decltype(utens)>::type,
+                   data_store_3d_float_t>::value,
+      "The tendencies are not stored in single precision");
+  check(utens.valid(), "Invalid single precision field");
+  check(fpool.bind_arg<vadvect, vadvect::datatens>(utens) != 0,
+        "The single precision placeholder was not bound");
+  for (field_stats const &f : fpool.stats().m_fields)
+    if (f.m_name == std::string("utens"))
+      check(f.m_element_size == sizeof(float),
+            "Wrong element size of a single precision field");
+}
+
+// the time levels can not be rotated while a context imports fields from
+// the context, since the imported fields would keep the previous level
+void check_rotate_importers() {
+  field_pool fpool(grid_descriptor(8, 8, 4, 2));
+  auto dycore = fpool.enter_context<dycore_param>();
+  {
+    auto fw = fpool.enter_context<fast_waves_sc_param>(dycore);
+    check(throws([&]() { fpool.rotate_time_levels<dycore_param>(); }),
+          "Rotated the time levels of an imported context");
+  }
+  auto *now = &fpool.get_st<dycore_param, dycore_param::w, 1>(dycore);
+  fpool.rotate_time_levels<dycore_param>();
+  check(&fpool.get_st<dycore_param, dycore_param::w>(dycore) == now,
+        "The time levels were not rotated");
+}
+
+} // namespace
+
+int main() {
+  const std::pair<char const *, std::function<void()>> checks[] = {
+      {"output_exceptions", check_output_exceptions},
+      {"output_write_errors", check_output_write_errors},
+      {"scratch_reuse", check_scratch_reuse},
+      {"scratch_shape", check_scratch_shape},
+      {"alias_group", check_alias_group},
+      {"runtime_lookup", check_runtime_lookup},
+      {"add_tracer", check_add_tracer},
+      {"guard_order", check_guard_order},
+      {"guard_pool", check_guard_pool},
+      {"bind_arg", check_bind_arg},
+      {"restart", check_restart},
+      {"split_domain", check_split_domain},
+      {"float_fields", check_float_fields},
+      {"rotate_importers", check_rotate_importers}};
+
+  unsigned int failed = 0;
+  for (auto const &c : checks) {
+    try {
+      c.second();
+    } catch (std::exception const &e) {
+      std::cerr << c.first << ": " << e.what() << std::endl;
+      ++failed;
+    }
+  }
+  return failed ? 1 : 0;
+}
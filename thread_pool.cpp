@@ -0,0 +1,144 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+#include "thread_pool.hpp"
+
+namespace {
+// pool and index of the worker running in the current thread
+thread_local thread_pool *t_pool = NULL;
+thread_local unsigned int t_worker = 0;
+}
+
+thread_pool::thread_pool(unsigned int nthreads)
+    : m_pending(0), m_queued(0), m_next_queue(0), m_stop(false) {
+  if (!nthreads)
+    nthreads = 1;
+  for (unsigned int i = 0; i < nthreads; ++i)
+    m_queues.push_back(std::unique_ptr<worker_queue>(new worker_queue()));
+  for (unsigned int i = 0; i < nthreads; ++i)
+    m_threads.push_back(std::thread(&thread_pool::worker_loop, this, i));
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_work_cv.notify_all();
+  for (auto &thread : m_threads)
+    thread.join();
+}
+
+void thread_pool::submit(std::function<void()> task) {
+  ++m_pending;
+  const unsigned int queue = (t_pool == this)
+                                 ? t_worker
+                                 : m_next_queue++ % m_queues.size();
+  {
+    std::lock_guard<std::mutex> lock(m_queues[queue]->m_mutex);
+    m_queues[queue]->m_tasks.push_back(std::move(task));
+  }
+  ++m_queued;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+  }
+  m_work_cv.notify_one();
+}
+
+void thread_pool::wait() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done_cv.wait(lock, [this]() { return m_pending == 0; });
+  if (m_exception) {
+    std::exception_ptr exception = m_exception;
+    m_exception = std::exception_ptr();
+    std::rethrow_exception(exception);
+  }
+}
+
+bool thread_pool::pop(unsigned int worker, std::function<void()> &task) {
+  // first from the back of our own deque
+  {
+    worker_queue &queue = *m_queues[worker];
+    std::lock_guard<std::mutex> lock(queue.m_mutex);
+    if (!queue.m_tasks.empty()) {
+      task = std::move(queue.m_tasks.back());
+      queue.m_tasks.pop_back();
+      --m_queued;
+      return true;
+    }
+  }
+  // then steal from the front of the deques of the other workers
+  for (unsigned int i = 1; i < m_queues.size(); ++i) {
+    worker_queue &queue = *m_queues[(worker + i) % m_queues.size()];
+    std::lock_guard<std::mutex> lock(queue.m_mutex);
+    if (!queue.m_tasks.empty()) {
+      task = std::move(queue.m_tasks.front());
+      queue.m_tasks.pop_front();
+      --m_queued;
+      return true;
+    }
+  }
+  return false;
+}
+
+void thread_pool::worker_loop(unsigned int worker) {
+  t_pool = this;
+  t_worker = worker;
+
+  std::function<void()> task;
+  while (true) {
+    if (pop(worker, task)) {
+      try {
+        task();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_exception)
+          m_exception = std::current_exception();
+      }
+      task = std::function<void()>();
+      if (--m_pending == 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done_cv.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_work_cv.wait(lock, [this]() { return m_stop || m_queued > 0; });
+    if (m_stop && m_queued == 0)
+      return;
+  }
+}
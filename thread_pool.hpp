@@ -0,0 +1,93 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work stealing thread pool. Each worker owns a deque of tasks: tasks
+ * submitted from a worker are pushed to its own deque and popped in LIFO
+ * order, while idle workers steal from the front of the deques of the
+ * others. Tasks submitted from outside the pool are distributed round robin.
+ */
+class thread_pool {
+public:
+  explicit thread_pool(
+      unsigned int nthreads = std::thread::hardware_concurrency());
+  ~thread_pool();
+
+  thread_pool(thread_pool const &) = delete;
+  thread_pool &operator=(thread_pool const &) = delete;
+
+  unsigned int size() const { return m_threads.size(); }
+
+  void submit(std::function<void()> task);
+
+  // waits until all the submitted tasks (including the ones submitted by
+  // other tasks) are finished. If a task threw, the first exception is
+  // rethrown. It must not be called from a task of the pool.
+  void wait();
+
+private:
+  struct worker_queue {
+    std::mutex m_mutex;
+    std::deque<std::function<void()>> m_tasks;
+  };
+
+  bool pop(unsigned int worker, std::function<void()> &task);
+  void worker_loop(unsigned int worker);
+
+  std::vector<std::unique_ptr<worker_queue>> m_queues;
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_mutex;
+  std::condition_variable m_work_cv;
+  std::condition_variable m_done_cv;
+  // tasks submitted but not finished, and tasks waiting in the deques
+  std::atomic<unsigned int> m_pending;
+  std::atomic<unsigned int> m_queued;
+  std::atomic<unsigned int> m_next_queue;
+  bool m_stop;
+  std::exception_ptr m_exception;
+};
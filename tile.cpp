@@ -0,0 +1,61 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#include "tile.hpp"
+
+std::vector<tile_descriptor> decompose(grid_descriptor const &grid,
+                                       tiling const &tiles) {
+  if (tiles.ntiles_i() > grid.nx() || tiles.ntiles_j() > grid.ny())
+    throw(std::runtime_error("More tiles than points in the domain"));
+
+  std::vector<tile_descriptor> res;
+  unsigned int j0 = 0;
+  for (unsigned int tj = 0; tj < tiles.ntiles_j(); ++tj) {
+    const unsigned int ny = grid.ny() / tiles.ntiles_j() +
+                            (tj < grid.ny() % tiles.ntiles_j() ? 1 : 0);
+    unsigned int i0 = 0;
+    for (unsigned int ti = 0; ti < tiles.ntiles_i(); ++ti) {
+      const unsigned int nx = grid.nx() / tiles.ntiles_i() +
+                              (ti < grid.nx() % tiles.ntiles_i() ? 1 : 0);
+      res.push_back(tile_descriptor{
+          (unsigned int)res.size(), i0, j0,
+          grid_descriptor(nx, ny, grid.nz(), grid.halo(), grid.alignment(),
+                          grid.padding())});
+      i0 += nx;
+    }
+    j0 += ny;
+  }
+  return res;
+}
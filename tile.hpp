@@ -0,0 +1,156 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#pragma once
+#include <vector>
+#include "grid_descriptor.hpp"
+#include "param_definitions.hpp"
+
+/**
+ * Decomposition of the horizontal domain in ntiles_i x ntiles_j tiles
+ */
+struct tiling {
+  tiling(unsigned int ntiles_i = 1, unsigned int ntiles_j = 1)
+      : m_ntiles_i(ntiles_i), m_ntiles_j(ntiles_j) {
+    if (!ntiles_i || !ntiles_j)
+      throw(std::runtime_error("The number of tiles must be non zero"));
+  }
+
+  unsigned int ntiles_i() const { return m_ntiles_i; }
+  unsigned int ntiles_j() const { return m_ntiles_j; }
+  unsigned int size() const { return m_ntiles_i * m_ntiles_j; }
+
+private:
+  unsigned int m_ntiles_i, m_ntiles_j;
+};
+
+/**
+ * Tile of the domain: its own grid, with the halo and alignment of the
+ * domain, and the position (i0, j0) of its compute domain in the compute
+ * domain of the whole grid
+ */
+struct tile_descriptor {
+  unsigned int m_index;
+  unsigned int m_i0, m_j0;
+  grid_descriptor m_grid;
+};
+
+// splits the compute domain of the grid in tiles, the first tiles of each
+// dimension get one more point if the size is not divisible. Tiles are
+// numbered with i varying fastest
+std::vector<tile_descriptor> decompose(grid_descriptor const &grid,
+                                       tiling const &tiles);
+
+// storage infos of the shapes of the fields on the grid
+inline storage_infos_t make_storage_infos(grid_descriptor const &grid) {
+  return storage_infos_t(
+      storage_info_3d_t(grid.isize(), grid.jsize(), grid.ksize()),
+      storage_info_2d_t(grid.isize(), grid.jsize()),
+      storage_info_3d_stag_t(grid.isize(), grid.jsize(),
+                             grid.ksize_staggered()),
+      storage_info_1d_t(1, 1, grid.ksize()),
+      storage_info_3d_column_t(grid.isize(), grid.jsize(), grid.ksize()));
+}
+
+// position of the element (i, j, k) in the memory of a storage
+inline int element_index(storage_info_3d_t const &sinfo, int i, int j,
+                         int k) {
+  return sinfo.index(i, j, k);
+}
+
+inline int element_index(storage_info_2d_t const &sinfo, int i, int j, int) {
+  return sinfo.index(i, j);
+}
+
+inline int element_index(storage_info_3d_stag_t const &sinfo, int i, int j,
+                         int k) {
+  return sinfo.index(i, j, k);
+}
+
+inline int element_index(storage_info_1d_t const &sinfo, int, int, int k) {
+  return sinfo.index(0, 0, k);
+}
+
+inline int element_index(storage_info_3d_column_t const &sinfo, int i, int j,
+                         int k) {
+  return sinfo.index(i, j, k);
+}
+
+// number of levels of the storages of a storage info
+inline int levels(storage_info_3d_t const &sinfo) {
+  return sinfo.template dim<2>();
+}
+
+inline int levels(storage_info_2d_t const &) { return 1; }
+
+inline int levels(storage_info_3d_stag_t const &sinfo) {
+  return sinfo.template dim<2>();
+}
+
+inline int levels(storage_info_3d_column_t const &sinfo) {
+  return sinfo.template dim<2>();
+}
+
+/**
+ * Copies the block of ni x nj columns starting at (si, sj) of the storage
+ * src into the block starting at (di, dj) of the storage dst. Positions are
+ * given in storage coordinates, i.e. including the halo
+ */
+template <typename DataStore>
+void copy_block(DataStore const &src, int si, int sj, DataStore &dst, int di,
+                int dj, int ni, int nj) {
+  auto const &src_sinfo = *src.get_storage_info_ptr();
+  auto const &dst_sinfo = *dst.get_storage_info_ptr();
+  auto const *src_ptr = src.get_storage_ptr()->get_cpu_ptr();
+  auto *dst_ptr = dst.get_storage_ptr()->get_cpu_ptr();
+  const int nk = levels(src_sinfo);
+  for (int i = 0; i < ni; ++i)
+    for (int j = 0; j < nj; ++j)
+      for (int k = 0; k < nk; ++k)
+        dst_ptr[element_index(dst_sinfo, di + i, dj + j, k)] =
+            src_ptr[element_index(src_sinfo, si + i, sj + j, k)];
+}
+
+// the columns are the same for all the tiles, only the levels are copied
+template <typename T>
+void copy_block(data_store_1d<T> const &src, int, int, data_store_1d<T> &dst,
+                int, int, int, int) {
+  auto const &src_sinfo = *src.get_storage_info_ptr();
+  auto const &dst_sinfo = *dst.get_storage_info_ptr();
+  auto const *src_ptr = src.get_storage_ptr()->get_cpu_ptr();
+  auto *dst_ptr = dst.get_storage_ptr()->get_cpu_ptr();
+  for (int k = 0; k < src_sinfo.template dim<2>(); ++k)
+    dst_ptr[dst_sinfo.index(0, 0, k)] = src_ptr[src_sinfo.index(0, 0, k)];
+}
@@ -0,0 +1,95 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#include "trace.hpp"
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+// buffer of the current thread in the recorder
+thread_local trace_buffer *t_buffer = NULL;
+}
+
+trace_recorder &trace_recorder::instance() {
+  static trace_recorder recorder;
+  return recorder;
+}
+
+trace_buffer &trace_recorder::local() {
+  if (!t_buffer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_buffers.push_back(std::unique_ptr<trace_buffer>(
+        new trace_buffer(m_buffers.size(), m_capacity)));
+    t_buffer = m_buffers.back().get();
+  }
+  return *t_buffer;
+}
+
+void trace_recorder::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto &buffer : m_buffers)
+    buffer->clear();
+}
+
+void trace_recorder::write_chrome_trace(std::ostream &os) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  os << "{\"traceEvents\": [";
+  bool first = true;
+  for (auto const &buffer : m_buffers) {
+    const std::size_t count = buffer->count();
+    const std::size_t begin =
+        (count > buffer->capacity()) ? count - buffer->capacity() : 0;
+    for (std::size_t i = begin; i < count; ++i) {
+      trace_event const &event = buffer->event(i);
+      os << (first ? "" : ",") << "\n  {\"name\": \"" << event.m_name
+         << "\", \"cat\": \"" << event.m_category
+         << "\", \"ph\": \"" << event.m_phase
+         << "\", \"ts\": " << event.m_time / 1000 << "."
+         << (event.m_time % 1000) / 100 << (event.m_time % 100) / 10
+         << event.m_time % 10 << ", \"pid\": 0, \"tid\": " << buffer->tid()
+         << "}";
+      first = false;
+    }
+  }
+  os << "\n]}\n";
+}
+
+void trace_recorder::write_chrome_trace(std::string const &path) const {
+  std::ofstream out(path);
+  write_chrome_trace(out);
+  out.close();
+  if (!out)
+    throw(std::runtime_error("Can not write the trace to " + path));
+}
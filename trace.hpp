@@ -0,0 +1,175 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// spans are only recorded if FIELD_POOL_TRACE is set, otherwise the tracing
+// macros expand to nothing
+#ifndef FIELD_POOL_TRACE
+#define FIELD_POOL_TRACE 0
+#endif
+
+// beginning ('B') or end ('E') of a span. Categories and names must be
+// string literals (or outlive the recorder), since only the pointers are
+// recorded
+struct trace_event {
+  char const *m_category;
+  char const *m_name;
+  std::uint64_t m_time;
+  char m_phase;
+};
+
+/**
+ * Ring buffer of the events of one thread, preallocated at the first event
+ * of the thread. When it is full the oldest events are overwritten
+ */
+class trace_buffer {
+public:
+  trace_buffer(unsigned int tid, std::size_t capacity)
+      : m_tid(tid), m_events(capacity), m_count(0) {}
+
+  // only called by the thread owning the buffer
+  void record(char const *category, char const *name, std::uint64_t time,
+              char phase) {
+    const std::size_t count = m_count.load(std::memory_order_relaxed);
+    trace_event &event = m_events[count % m_events.size()];
+    event.m_category = category;
+    event.m_name = name;
+    event.m_time = time;
+    event.m_phase = phase;
+    m_count.store(count + 1, std::memory_order_release);
+  }
+
+  unsigned int tid() const { return m_tid; }
+  std::size_t count() const { return m_count.load(std::memory_order_acquire); }
+  std::size_t capacity() const { return m_events.size(); }
+  trace_event const &event(std::size_t i) const {
+    return m_events[i % m_events.size()];
+  }
+  void clear() { m_count.store(0, std::memory_order_release); }
+
+private:
+  unsigned int m_tid;
+  std::vector<trace_event> m_events;
+  std::atomic<std::size_t> m_count;
+};
+
+/**
+ * Records nested spans (contexts and operators) of all the threads, and
+ * exports them in the Chrome trace format (chrome://tracing, Perfetto). The
+ * export should be done while no thread is recording
+ */
+class trace_recorder {
+public:
+  static constexpr std::size_t default_capacity = 1 << 16;
+
+  static trace_recorder &instance();
+
+  void begin(char const *category, char const *name) {
+    local().record(category, name, now(), 'B');
+  }
+  void end(char const *category, char const *name) {
+    local().record(category, name, now(), 'E');
+  }
+
+  // capacity of the buffers of the threads that did not record yet
+  void set_capacity(std::size_t capacity) { m_capacity = capacity; }
+
+  void clear();
+
+  void write_chrome_trace(std::ostream &os) const;
+  void write_chrome_trace(std::string const &path) const;
+
+private:
+  trace_recorder()
+      : m_start(std::chrono::steady_clock::now()),
+        m_capacity(default_capacity) {}
+
+  std::uint64_t now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - m_start)
+        .count();
+  }
+
+  // buffer of the calling thread, created at its first event
+  trace_buffer &local();
+
+  std::chrono::steady_clock::time_point m_start;
+  std::atomic<std::size_t> m_capacity;
+  mutable std::mutex m_mutex;
+  std::vector<std::unique_ptr<trace_buffer>> m_buffers;
+};
+
+// span covering the lifetime of the object
+class trace_scope {
+public:
+  trace_scope(char const *category, char const *name)
+      : m_category(category), m_name(name) {
+    trace_recorder::instance().begin(m_category, m_name);
+  }
+  ~trace_scope() { trace_recorder::instance().end(m_category, m_name); }
+
+  trace_scope(trace_scope const &) = delete;
+  trace_scope &operator=(trace_scope const &) = delete;
+
+private:
+  char const *m_category;
+  char const *m_name;
+};
+
+#define FIELD_POOL_TRACE_CONCAT_(a, b) a##b
+#define FIELD_POOL_TRACE_CONCAT(a, b) FIELD_POOL_TRACE_CONCAT_(a, b)
+
+#if FIELD_POOL_TRACE
+#define FIELD_POOL_TRACE_SCOPE(category, name)                                \
+  trace_scope FIELD_POOL_TRACE_CONCAT(trace_scope_, __LINE__)(category, name)
+#define FIELD_POOL_TRACE_BEGIN(category, name)                                \
+  trace_recorder::instance().begin(category, name)
+#define FIELD_POOL_TRACE_END(category, name)                                  \
+  trace_recorder::instance().end(category, name)
+#else
+#define FIELD_POOL_TRACE_SCOPE(category, name)
+#define FIELD_POOL_TRACE_BEGIN(category, name)
+#define FIELD_POOL_TRACE_END(category, name)
+#endif
@@ -0,0 +1,148 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include "param_definitions.hpp"
+#include "grid_descriptor.hpp"
+#include "arena.hpp"
+
+/**
+ * Container of the tracers of a context. Tracers are added by name at model
+ * setup, and all of them are stored in a single allocation, one 3d field
+ * after the other, so that the tracer index is the outermost dimension.
+ * The storages can be accessed per tracer (3d views) or as a whole bundle
+ * (a 4d view), which allows operators to process all the tracers in one
+ * sweep.
+ */
+class tracer_bundle {
+public:
+  tracer_bundle(grid_descriptor const &grid,
+                storage_info_3d_t const &sinfo_3d,
+                allocation_mode mode = allocation_mode::per_field)
+      : m_grid(grid), m_sinfo_3d(sinfo_3d), m_mode(mode) {}
+
+  // adds a tracer and returns its index in the bundle. Tracers can only be
+  // added while the bundle is not allocated, i.e. during model setup
+  unsigned int add_tracer(std::string const &name) {
+    if (is_allocated())
+      throw(std::runtime_error("Can not add a tracer to an allocated bundle"));
+    if (std::find(m_names.begin(), m_names.end(), name) != m_names.end())
+      throw(std::runtime_error("Tracer " + name + " is already registered"));
+    m_names.push_back(name);
+    return m_names.size() - 1;
+  }
+
+  unsigned int size() const { return m_names.size(); }
+  // bytes held by the bundle while it is allocated
+  std::size_t footprint() const {
+    return is_allocated() ? tracer_bytes() * m_names.size() : 0;
+  }
+  std::string const &name(unsigned int tracer) const { return m_names[tracer]; }
+
+  unsigned int index(std::string const &name) const {
+    auto it = std::find(m_names.begin(), m_names.end(), name);
+    if (it == m_names.end())
+      throw(std::runtime_error("Unknown tracer " + name));
+    return it - m_names.begin();
+  }
+
+  bool is_allocated() const { return (bool)m_arena; }
+
+  void allocate() {
+    if (is_allocated() || m_names.empty())
+      return;
+    const std::size_t bytes = tracer_bytes();
+    m_arena = std::make_shared<arena>(
+        bytes * m_names.size(), m_mode == allocation_mode::arena_huge_pages);
+    gridtools::float_type *ptr =
+        reinterpret_cast<gridtools::float_type *>(m_arena->data());
+
+    for (unsigned int t = 0; t < m_names.size(); ++t) {
+      m_arena->first_touch(t * bytes, bytes);
+      m_tracers.push_back(data_store_3d_t(m_sinfo_3d, ptr + t * tracer_size()));
+    }
+
+    m_sinfo_bundle.reset(new storage_info_tracer_t(
+        m_grid.isize(), m_grid.jsize(), m_grid.ksize(), m_names.size()));
+    m_bundle = data_store_tracer_t(*m_sinfo_bundle, ptr);
+  }
+
+  // the views do not own the memory, therefore handles to them must not
+  // outlive the context of the bundle
+  void release() {
+    m_tracers.clear();
+    m_bundle = data_store_tracer_t();
+    m_sinfo_bundle.reset();
+    m_arena.reset();
+  }
+
+  data_store_3d_t const &get_tracer(unsigned int tracer) const {
+    if (tracer >= m_tracers.size())
+      throw(std::runtime_error("Tracer not allocated"));
+    return m_tracers[tracer];
+  }
+
+  data_store_3d_t const &get_tracer(std::string const &name) const {
+    return get_tracer(index(name));
+  }
+
+  data_store_tracer_t const &get_bundle() const {
+    if (!is_allocated())
+      throw(std::runtime_error("Tracer bundle not allocated"));
+    return m_bundle;
+  }
+
+private:
+  std::size_t tracer_size() const { return m_sinfo_3d.size(); }
+  std::size_t tracer_bytes() const {
+    return tracer_size() * sizeof(gridtools::float_type);
+  }
+
+  grid_descriptor const &m_grid;
+  storage_info_3d_t const &m_sinfo_3d;
+  allocation_mode m_mode;
+  std::vector<std::string> m_names;
+
+  std::shared_ptr<arena> m_arena;
+  std::vector<data_store_3d_t> m_tracers;
+  std::unique_ptr<storage_info_tracer_t> m_sinfo_bundle;
+  data_store_tracer_t m_bundle;
+};
@@ -0,0 +1,103 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#include <algorithm>
+#include "transpose.hpp"
+
+namespace {
+// contiguous dimension of a layout, i.e. the one with the smallest non zero
+// stride (0 if all the dimensions have size 1)
+int contiguous_dim(strides_t const &strides) {
+  int res = -1;
+  for (int d = 0; d < 3; ++d)
+    if (strides[d] && (res < 0 || strides[d] < strides[res]))
+      res = d;
+  return res < 0 ? 0 : res;
+}
+
+template <typename T>
+void transpose_impl(T const *src, strides_t const &ss, T *dst,
+                    strides_t const &ds, shape_t const &shape) {
+  const int a = contiguous_dim(ss);
+  const int b = contiguous_dim(ds);
+  if (a == b) {
+    // the rows along a are contiguous on both sides
+    const int o1 = (a + 1) % 3, o2 = (a + 2) % 3;
+    const long n1 = shape[o1], n2 = shape[o2], na = shape[a];
+#pragma omp parallel for schedule(static)
+    for (long x = 0; x < n1; ++x)
+      for (long y = 0; y < n2; ++y) {
+        T const *s = src + x * ss[o1] + y * ss[o2];
+        T *d = dst + x * ds[o1] + y * ds[o2];
+        for (long z = 0; z < na; ++z)
+          d[z * ds[a]] = s[z * ss[a]];
+      }
+    return;
+  }
+
+  // blocks of the plane (a, b), read along a and written along b
+  const int c = 3 - a - b;
+  const long na = shape[a], nb = shape[b], nc = shape[c];
+  const long blk = transpose_block;
+#pragma omp parallel for schedule(static)
+  for (long z = 0; z < nc; ++z)
+    for (long b0 = 0; b0 < nb; b0 += blk)
+      for (long a0 = 0; a0 < na; a0 += blk) {
+        const long b1 = std::min(b0 + blk, nb), a1 = std::min(a0 + blk, na);
+        T const *s = src + z * ss[c];
+        T *d = dst + z * ds[c];
+        for (long y = b0; y < b1; ++y)
+          for (long x = a0; x < a1; ++x)
+            d[x * ds[a] + y * ds[b]] = s[x * ss[a] + y * ss[b]];
+      }
+}
+} // namespace
+
+void transpose_copy(char const *src, strides_t const &src_strides, char *dst,
+                    strides_t const &dst_strides, shape_t const &shape,
+                    std::size_t element_size) {
+  switch (element_size) {
+  case 4:
+    transpose_impl(reinterpret_cast<float const *>(src), src_strides,
+                   reinterpret_cast<float *>(dst), dst_strides, shape);
+    break;
+  case 8:
+    transpose_impl(reinterpret_cast<double const *>(src), src_strides,
+                   reinterpret_cast<double *>(dst), dst_strides, shape);
+    break;
+  default:
+    throw(std::runtime_error("Unsupported element size in transposition"));
+  }
+}
@@ -0,0 +1,112 @@
+/*
+  GridTools Libraries
+
+  Copyright (c) 2017, ETH Zurich and MeteoSwiss
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+  For information: http://eth-cscs.github.io/gridtools/
+*/
+#pragma once
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include "tile.hpp"
+
+// strides (in elements) of the i, j and k dimensions of an array, and its
+// sizes along them
+typedef std::array<long, 3> strides_t;
+typedef std::array<unsigned int, 3> shape_t;
+
+/**
+ * Copies a 3d array of elements of element_size bytes between two layouts.
+ * If the source and the destination have a different contiguous dimension,
+ * the array is transposed in blocks of transpose_block x transpose_block
+ * elements of these two dimensions, so that both the reads and the writes
+ * of a block stay in the cache. Otherwise the contiguous rows are copied.
+ * The planes of the remaining dimension are copied in parallel.
+ */
+void transpose_copy(char const *src, strides_t const &src_strides, char *dst,
+                    strides_t const &dst_strides, shape_t const &shape,
+                    std::size_t element_size);
+
+constexpr unsigned int transpose_block = 32;
+
+// strides of the storages of a storage info, 0 for the dimensions of size 1
+template <typename StorageInfo>
+strides_t storage_strides(StorageInfo const &sinfo) {
+  const shape_t shape = storage_shape(sinfo);
+  const long base = element_index(sinfo, 0, 0, 0);
+  return {{shape[0] > 1 ? element_index(sinfo, 1, 0, 0) - base : 0,
+           shape[1] > 1 ? element_index(sinfo, 0, 1, 0) - base : 0,
+           shape[2] > 1 ? element_index(sinfo, 0, 0, 1) - base : 0}};
+}
+
+// whether the storages of two storage infos have the same layout, i.e. a
+// field can be used in the other layout without transposing it
+template <typename SrcStorageInfo, typename DstStorageInfo>
+struct same_layout
+    : std::is_same<typename storage_layout<SrcStorageInfo>::type,
+                   typename storage_layout<DstStorageInfo>::type> {};
+
+// data store with the storage info sinfo on top of the memory of src, that
+// has the same layout, shape and value type. It does not own the memory
+template <typename DstStore, typename SrcStore>
+DstStore view_of(SrcStore const &src,
+                 typename DstStore::storage_info_t const &sinfo) {
+  static_assert(std::is_same<typename SrcStore::data_t,
+                             typename DstStore::data_t>::value,
+                "The fields have different value types");
+  if (storage_shape(*src.get_storage_info_ptr()) != storage_shape(sinfo))
+    throw(std::runtime_error("The fields have different shapes"));
+  return DstStore(sinfo, src.get_storage_ptr()->get_cpu_ptr());
+}
+
+/**
+ * Copies the field src into dst, that have the same shape and value type
+ * but possibly different layouts (e.g. data_store_3d_t and
+ * data_store_3d_column_t), transposing it if needed
+ */
+template <typename SrcStore, typename DstStore>
+void transpose_field(SrcStore const &src, DstStore &dst) {
+  static_assert(std::is_same<typename SrcStore::data_t,
+                             typename DstStore::data_t>::value,
+                "The fields have different value types");
+  auto const &src_sinfo = *src.get_storage_info_ptr();
+  auto const &dst_sinfo = *dst.get_storage_info_ptr();
+  const shape_t shape = storage_shape(src_sinfo);
+  if (shape != storage_shape(dst_sinfo))
+    throw(std::runtime_error("The fields have different shapes"));
+  transpose_copy(
+      reinterpret_cast<char const *>(src.get_storage_ptr()->get_cpu_ptr()),
+      storage_strides(src_sinfo),
+      reinterpret_cast<char *>(dst.get_storage_ptr()->get_cpu_ptr()),
+      storage_strides(dst_sinfo), shape, sizeof(typename SrcStore::data_t));
+}